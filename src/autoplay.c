@@ -0,0 +1,232 @@
+/**
+ * tp2 - Autoplay Routines
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <curses.h>
+
+#ifndef PDCURSES
+#include <sys/time.h>
+#endif
+
+#include "game.h"
+#include "ui.h"
+#include "stats.h"
+#include "autoplay.h"
+
+/* Number of moves between checks of the clock */
+#define CLOCK_INTERVAL 256
+
+/* Games being played */
+static struct game games[AUTOPLAY_MAX];
+static int count = 0;
+
+/* Game type to (re)start games with */
+static int game_type = 11;
+
+/* Moves per second per game (0 = no limit) */
+static long rate = 0;
+
+/* Fraction of a move carried over into the next frame, in thousandths */
+static long carry = 0;
+
+/* Moves that were due, but didn't fit in the previous frames */
+static long due = 0;
+
+/* When the current frame started, in milliseconds */
+static unsigned long frame_start = 0;
+
+/* Points scored and moves made in each game so far */
+static unsigned long points[AUTOPLAY_MAX];
+static unsigned long moves[AUTOPLAY_MAX];
+
+/* Statistics for all games played, and where to write them */
+static struct stats stats;
+static FILE *stats_fp = NULL;
+static time_t started, last_snapshot;
+
+/* Error messages for autoplay_stats() */
+static const char *error_messages[1] = {
+	"unable to open the statistics file"
+};
+
+/**
+ * Get the wall-clock time in milliseconds, from an arbitrary
+ * starting point.
+ */
+static unsigned long now(void)
+{
+#ifdef PDCURSES
+	/* On DOS, clock() counts real time, 18.2 ticks a second. */
+	return (unsigned long)clock() * 10000UL /
+	       (unsigned long)(CLOCKS_PER_SEC * 10);
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (unsigned long)tv.tv_sec * 1000UL +
+	       (unsigned long)tv.tv_usec / 1000UL;
+#endif
+}
+
+/**
+ * Make one move in every game, restarting any that have
+ * been won or lost.
+ */
+static void step(void)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (games[i].game_state) {
+			init_game_state(&games[i], game_type, games[i].rng);
+			points[i] = moves[i] = 0;
+			continue;
+		}
+
+		game_move(&games[i], rand() & 3);
+		points[i] += games[i].reward;
+		moves[i]++;
+
+		stats_add_move(&stats, &games[i]);
+		if (games[i].game_state)
+			stats_add_game(&stats, &games[i], points[i], moves[i]);
+	}
+}
+
+/**
+ * Append a snapshot of the statistics to the statistics file.
+ */
+static void snapshot(void)
+{
+	last_snapshot = time(NULL);
+	if (stats_write(&stats, stats_fp,
+	                (unsigned long)(last_snapshot - started))) {
+		fclose(stats_fp);
+		stats_fp = NULL;
+	}
+}
+
+/**
+ * Start autoplaying a number of games.
+ */
+void autoplay_init(int n, int type, unsigned long seed, long r)
+{
+	int i;
+
+	count = (n < 1) ? 1 : (n > AUTOPLAY_MAX) ? AUTOPLAY_MAX : n;
+	game_type = type;
+	rate = r;
+	carry = due = 0;
+	frame_start = now();
+	memset(points, 0, sizeof(points));
+	memset(moves, 0, sizeof(moves));
+	memset(&stats, 0, sizeof(stats));
+
+	srand((unsigned int)seed);
+	for (i = 0; i < count; i++)
+		init_game_state(&games[i], type, seed + (unsigned long)i);
+}
+
+/**
+ * Play the moves that are due in one frame.
+ */
+void autoplay_frame(void)
+{
+	clock_t end = clock() + CLOCKS_PER_SEC / AUTOPLAY_FPS;
+	unsigned long t = now(), elapsed = t - frame_start;
+	long n;
+
+	frame_start = t;
+	if (!rate) {
+		do {
+			for (n = 0; n < CLOCK_INTERVAL; n++)
+				step();
+		} while (clock() < end);
+	} else {
+		/**
+		 * The moves due follow the time since the last frame,
+		 * so time spent drawing and waiting for keys doesn't
+		 * slow down the games. Never fall more than a second
+		 * behind.
+		 */
+		if (elapsed > 1000) elapsed = 1000;
+		carry += rate % 1000 * (long)elapsed;
+		due += rate / 1000 * (long)elapsed + carry / 1000;
+		carry %= 1000;
+		if (due > rate) due = rate;
+
+		/**
+		 * Stop when the frame's time is up, so that a rate
+		 * the machine can't keep up with doesn't hold back
+		 * drawing and input. The rest is played later.
+		 */
+		do {
+			for (n = 0; n < CLOCK_INTERVAL && due; n++, due--)
+				step();
+		} while (due && clock() < end);
+	}
+
+	if (stats_fp && time(NULL) != last_snapshot)
+		snapshot();
+}
+
+/**
+ * Get how long to wait for a key before the next frame.
+ */
+int autoplay_timeout(void)
+{
+	unsigned long spent = now() - frame_start;
+
+	if (!rate || spent >= 1000 / AUTOPLAY_FPS)
+		return 0;
+	return (int)(1000 / AUTOPLAY_FPS - spent);
+}
+
+/**
+ * Append a snapshot of the statistics to a file once
+ * per second.
+ */
+const char *autoplay_stats(const char *file)
+{
+	if (!(stats_fp = fopen(file, "a")))
+		return error_messages[0];
+
+	started = last_snapshot = time(NULL);
+	return NULL;
+}
+
+/**
+ * Stop autoplaying, writing the final statistics.
+ */
+void autoplay_uninit(void)
+{
+	if (!stats_fp) return;
+
+	snapshot();
+	if (stats_fp) fclose(stats_fp);
+	stats_fp = NULL;
+}
+
+/**
+ * Draw the games on the dashboard.
+ */
+void autoplay_render(void)
+{
+	ui_render_dashboard(games, count);
+}
+
+/**
+ * Get one of the games being autoplayed.
+ */
+struct game *autoplay_game(int i)
+{
+	return &games[i];
+}
@@ -0,0 +1,74 @@
+/**
+ * tp2 - Autoplay Routines
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+/* Maximum number of games that can be autoplayed at once. */
+#define AUTOPLAY_MAX 64
+
+/* Number of times per second that autoplayed games are drawn. */
+#define AUTOPLAY_FPS 30
+
+struct game;
+
+/**
+ * Start autoplaying a number of games.
+ *
+ * \param[in] count Number of games (1 - AUTOPLAY_MAX.)
+ * \param[in] type  Game type (winning exponent of 2.)
+ * \param[in] seed  Seed for the first game.
+ * \param[in] rate  Moves per second per game, or 0 for no limit.
+ */
+void autoplay_init(int count, int type, unsigned long seed, long rate);
+
+/**
+ * Play the moves that are due in one frame.
+ *
+ * With no rate limit, this plays for one frame's worth of
+ * time; otherwise, it plays rate moves per second in each
+ * game for the time since the last frame, and the caller is
+ * expected to wait out the rest of the frame.
+ */
+void autoplay_frame(void);
+
+/**
+ * Get how long to wait for a key before the next frame.
+ *
+ * \return Milliseconds left in the current frame, or 0 if
+ *         there's no rate limit or the frame is over.
+ */
+int autoplay_timeout(void);
+
+/**
+ * Append a snapshot of the statistics for all games played
+ * to a file once per second.
+ *
+ * \param[in] file Path to the file.
+ * \return NULL on success, error message on error.
+ */
+const char *autoplay_stats(const char *file);
+
+/**
+ * Stop autoplaying, writing the final statistics.
+ */
+void autoplay_uninit(void);
+
+/**
+ * Draw the games on the dashboard.
+ */
+void autoplay_render(void);
+
+/**
+ * Get one of the games being autoplayed.
+ *
+ * \param[in] i Index of the game.
+ * \return The game.
+ */
+struct game *autoplay_game(int i);
+
+#endif /* AUTOPLAY_H */
@@ -0,0 +1,401 @@
+/**
+ * tp2 - Engine Conformance Check
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "game.h"
+#include "line.h"
+#include "tables.h"
+#include "check.h"
+
+/**
+ * Largest exponent on the boards we check.
+ *
+ * Two tiles of 2^15 can't meet in a game, since it's won as
+ * soon as the first one appears. move_line() doesn't mark the
+ * cell free when they would merge, and there's no need for the
+ * kernels to copy that.
+ */
+#define MAX_EXPONENT 14
+
+/* An alternative move kernel, with the same contract as game_slide() */
+struct kernel {
+	const char *name;
+	int (*slide)(struct game *g, int direction);
+};
+
+/* A difference found by a worker */
+struct difference {
+	int found;
+	int kernel;
+	int direction;
+	char board[BOARD_WIDTH * BOARD_HEIGHT];
+};
+
+static int packed_line_slide(struct game *g, int direction);
+
+/* Kernels to check against the engine */
+static const struct kernel kernels[] = {
+	{ "packed line", packed_line_slide },
+#ifdef HAVE_ROW_TABLES
+	{ "row table",   game_slide }
+#endif
+};
+
+#define KERNELS (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+/* Error messages for check_run() */
+static const char *error_messages[3] = {
+	"unable to start a worker",
+	"a worker failed to finish its checks",
+	"a kernel doesn't match the engine"
+};
+
+/**
+ * Move the board one line at a time with line_move().
+ *
+ * \param[in] g         Game state.
+ * \param[in] direction One of the MOVE_* constants.
+ * \return 1 if any tile was moved or merged, 0 otherwise.
+ */
+static int packed_line_slide(struct game *g, int direction)
+{
+	unsigned int line, moved;
+	int n, i, cell, stride, merged, changed = 0;
+
+	g->reward = 0;
+	g->merges = 0;
+
+	for (n = 0; n < LINES(direction); n++) {
+		cell = line_start(direction, n, &stride);
+		line = pack_line(g->board, cell, stride, LINE_LENGTH(direction));
+
+		moved = line_move(line, LINE_LENGTH(direction), &merged);
+		if (moved == line) continue;
+		changed = 1;
+
+		for (i = 0; i < LINE_LENGTH(direction); i++) {
+			g->board[cell + i * stride] =
+				(char)((moved >> (i << 2)) & 0x0f);
+		}
+
+		if (merged >= 0) {
+			g->reward += (unsigned int)(4 << merged);
+			g->merges++;
+			if (merged == g->game_type)
+				g->game_state = GAME_WON;
+		}
+	}
+
+	g->board_state = 0;
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++)
+		if (!g->board[i]) g->board_state |= (short)(1 << i);
+	return changed;
+}
+
+/**
+ * Set up a game with the given board.
+ *
+ * \param[out] g     Game state.
+ * \param[in]  board Cells.
+ */
+static void setup(struct game *g, const char *board)
+{
+	int i;
+
+	init_game_state(g, 15, 1);
+	memcpy(g->board, board, sizeof(g->board));
+	g->board_state = 0;
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++)
+		if (!board[i]) g->board_state |= (short)(1 << i);
+}
+
+/**
+ * Compare a kernel's move against the engine's.
+ *
+ * \param[in]  k         Kernel.
+ * \param[in]  board     Board to move.
+ * \param[in]  direction Direction to move.
+ * \param[out] ref       Game moved by the engine (or NULL.)
+ * \param[out] alt       Game moved by the kernel (or NULL.)
+ * \return 1 if they differ, 0 otherwise.
+ */
+static int differs(const struct kernel *k, const char *board,
+                   int direction, struct game *ref, struct game *alt)
+{
+	struct game a, b;
+	int ma, mb;
+
+	setup(&a, board);
+	b = a;
+	ma = game_slide_reference(&a, direction);
+	mb = k->slide(&b, direction);
+
+	if (ref) *ref = a;
+	if (alt) *alt = b;
+	return ma != mb || a.board_state != b.board_state ||
+	       a.game_state != b.game_state || a.reward != b.reward ||
+	       a.merges != b.merges ||
+	       memcmp(a.board, b.board, sizeof(a.board));
+}
+
+/**
+ * Check every kernel on one board, in every direction.
+ *
+ * \param[in]  board Board.
+ * \param[out] d     The difference, if one was found.
+ * \return 1 if a difference was found, 0 otherwise.
+ */
+static int check_board(const char *board, struct difference *d)
+{
+	int k, dir;
+
+	for (k = 0; k < KERNELS; k++) {
+		for (dir = MOVE_UP; dir <= MOVE_RIGHT; dir++) {
+			if (!differs(&kernels[k], board, dir, NULL, NULL))
+				continue;
+
+			d->found = 1;
+			d->kernel = k;
+			d->direction = dir;
+			memcpy(d->board, board, sizeof(d->board));
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Run one worker's share of the checks.
+ *
+ * Every possible line (up to MAX_EXPONENT) is checked on a board
+ * with every row holding it, and on one with every column holding
+ * it, then random boards are checked.
+ *
+ * \param[in]  w       Worker number.
+ * \param[in]  workers Number of workers.
+ * \param[in]  cases   Number of random boards (in total.)
+ * \param[out] d       The first difference found.
+ */
+static void work(int w, int workers, unsigned long cases,
+                 struct difference *d)
+{
+	char board[BOARD_WIDTH * BOARD_HEIGHT];
+	unsigned long v, x, lines = 1, rng;
+	int i, n, rows;
+
+	memset(d, 0, sizeof(*d));
+	for (i = 0; i < BOARD_WIDTH || i < BOARD_HEIGHT; i++)
+		lines *= MAX_EXPONENT + 1;
+
+	/* Every line, on every row and every column */
+	for (v = (unsigned long)w; v < lines; v += (unsigned long)workers) {
+		/* Cell (x, y) gets digit x of v, then digit y. */
+		for (rows = 1; rows >= 0; rows--) {
+			for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+				n = rows ? i % BOARD_WIDTH : i / BOARD_WIDTH;
+				for (x = v; n--; x /= MAX_EXPONENT + 1);
+				board[i] = (char)(x % (MAX_EXPONENT + 1));
+			}
+
+			if (check_board(board, d)) return;
+		}
+	}
+
+	/* Random boards, with about a third of the cells free */
+	rng = (unsigned long)w + 1;
+	for (v = (unsigned long)w; v < cases; v += (unsigned long)workers) {
+		for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+			rng = (rng * 1103515245UL + 12345UL) & 0xffffffffUL;
+			board[i] = (char)((rng >> 16) % (MAX_EXPONENT + 1));
+			if (((rng >> 8) & 0xff) < 85) board[i] = 0;
+		}
+
+		if (check_board(board, d)) return;
+	}
+}
+
+/**
+ * Shrink the board of a difference, clearing or lowering one
+ * tile at a time for as long as the difference remains.
+ *
+ * \param[in] d Difference.
+ */
+static void minimize(struct difference *d)
+{
+	const struct kernel *k = &kernels[d->kernel];
+	int i, shrunk = 1;
+	char old;
+
+	while (shrunk) {
+		for (i = 0, shrunk = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+			if (!(old = d->board[i])) continue;
+
+			d->board[i] = 0;
+			if (differs(k, d->board, d->direction, NULL, NULL)) {
+				shrunk = 1;
+				continue;
+			}
+
+			d->board[i] = (char)(old - 1);
+			if (old > 1 &&
+			    differs(k, d->board, d->direction, NULL, NULL)) {
+				shrunk = 1;
+				continue;
+			}
+			d->board[i] = old;
+		}
+	}
+}
+
+/**
+ * Print a board, and what a move made of it.
+ *
+ * \param[in] title Title.
+ * \param[in] g     Game state.
+ * \param[in] moved Whether the move reported moving anything.
+ */
+static void print_game(const char *title, const struct game *g, int moved)
+{
+	int x, y;
+
+	printf("%s:", title);
+	if (moved >= 0) {
+		printf(" moved %d, reward %u, merges %u, state %u, "
+		       "free %04x", moved, g->reward, g->merges,
+		       g->game_state, g->board_state & 0xffff);
+	}
+	putchar('\n');
+
+	for (y = 0; y < BOARD_HEIGHT; y++) {
+		for (x = 0; x < BOARD_WIDTH; x++)
+			printf(" %2d", g->board[y * BOARD_WIDTH + x]);
+		putchar('\n');
+	}
+}
+
+/**
+ * Print a difference.
+ *
+ * \param[in] d Difference.
+ */
+static void print_difference(const struct difference *d)
+{
+	static const char *directions[4] = { "up", "down", "left", "right" };
+	const struct kernel *k = &kernels[d->kernel];
+	struct game before, ref, alt;
+
+	differs(k, d->board, d->direction, &ref, &alt);
+	setup(&before, d->board);
+
+	printf("The %s kernel differs from the engine moving %s.\n",
+	       k->name, directions[d->direction]);
+	print_game("Board", &before, -1);
+
+	setup(&before, d->board);
+	print_game("Engine", &ref,
+	           game_slide_reference(&before, d->direction));
+	setup(&before, d->board);
+	print_game("Kernel", &alt, k->slide(&before, d->direction));
+}
+
+/**
+ * Read a difference from a worker.
+ *
+ * \param[in]  fd File descriptor.
+ * \param[out] d  Difference.
+ * \return 1 if a whole difference was read, 0 otherwise.
+ */
+static int read_difference(int fd, struct difference *d)
+{
+	size_t got = 0;
+	ssize_t n;
+
+	while (got < sizeof(*d)) {
+		n = read(fd, (char *)d + got, sizeof(*d) - got);
+		if (n <= 0) return 0;
+		got += (size_t)n;
+	}
+
+	return 1;
+}
+
+/**
+ * Check that every alternative move kernel gives exactly the
+ * same results as the engine.
+ */
+const char *check_run(unsigned long cases, int workers)
+{
+	int fds[CHECK_MAX_WORKERS];
+	struct difference d, first;
+	const char *err = NULL;
+	time_t start = time(NULL);
+	int w, fd[2], finished = 0;
+	pid_t pid;
+
+	if (workers < 1) workers = 1;
+	if (workers > CHECK_MAX_WORKERS)
+		workers = CHECK_MAX_WORKERS;
+	memset(&first, 0, sizeof(first));
+
+	for (w = 0; w < workers; w++) {
+		fds[w] = -1;
+		if (pipe(fd)) {
+			err = error_messages[0];
+			break;
+		}
+
+		if (!(pid = fork())) {
+			close(fd[0]);
+			work(w, workers, cases, &d);
+			if (write(fd[1], &d, sizeof(d)) != sizeof(d))
+				_exit(EXIT_FAILURE);
+			_exit(EXIT_SUCCESS);
+		}
+
+		close(fd[1]);
+		if (pid == -1) {
+			close(fd[0]);
+			err = error_messages[0];
+			break;
+		}
+		fds[w] = fd[0];
+	}
+
+	/* Collect the results, keeping the first difference reported. */
+	while (w--) {
+		if (read_difference(fds[w], &d)) {
+			++finished;
+			if (d.found && !first.found) first = d;
+		}
+		close(fds[w]);
+	}
+	while (wait(NULL) > 0);
+
+	if (!err && finished != workers)
+		err = error_messages[1];
+	if (err) return err;
+
+	if (first.found) {
+		minimize(&first);
+		print_difference(&first);
+		return error_messages[2];
+	}
+
+	printf("%d kernel(s) matched the engine on every line, and on "
+	       "%lu random boards, in %lds.\n", KERNELS, cases,
+	       (long)(time(NULL) - start));
+	return NULL;
+}
@@ -0,0 +1,28 @@
+/**
+ * tp2 - Engine Conformance Check
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef CHECK_H
+#define CHECK_H
+
+/* Maximum number of worker processes */
+#define CHECK_MAX_WORKERS 64
+
+/**
+ * Check that every alternative move kernel gives exactly the
+ * same results as the engine's own move_line(), on every
+ * possible line, and on a number of random boards.
+ *
+ * The first difference found is reduced to the smallest board
+ * that still shows it, and printed.
+ *
+ * \param[in] cases   Number of random boards to check.
+ * \param[in] workers Number of worker processes.
+ * \return NULL if everything matched, error message otherwise.
+ */
+const char *check_run(unsigned long cases, int workers);
+
+#endif /* CHECK_H */
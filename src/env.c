@@ -0,0 +1,94 @@
+/**
+ * tp2 - Reinforcement Learning Environment
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "env.h"
+
+/**
+ * Set up an environment, and start its first episode.
+ */
+void env_init(struct env *e, int type, int format, unsigned long seed,
+              unsigned char *obs)
+{
+	e->type = type;
+	e->format = format;
+	env_reset(e, seed, obs);
+}
+
+/**
+ * Start a new episode.
+ */
+void env_reset(struct env *e, unsigned long seed, unsigned char *obs)
+{
+	init_game_state(&e->game, e->type, seed);
+	if (obs) env_observe(e, obs);
+}
+
+/**
+ * Write the current observation.
+ */
+void env_observe(const struct env *e, unsigned char *obs)
+{
+	int i;
+
+	if (e->format != OBS_ONEHOT) {
+		for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++)
+			obs[i] = (unsigned char)(e->game.board[i] & 0x0f);
+		return;
+	}
+
+	memset(obs, 0, OBS_SIZE(OBS_ONEHOT));
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		obs[(e->game.board[i] & 0x0f) * BOARD_WIDTH * BOARD_HEIGHT +
+		    i] = 1;
+	}
+}
+
+/**
+ * Take one action.
+ */
+int env_step(struct env *e, int action, unsigned char *obs,
+             unsigned long *reward, unsigned char *mask)
+{
+	int done;
+
+	game_move(&e->game, action);
+	if (reward) *reward = e->game.reward;
+
+	done = e->game.game_state;
+	if (done) env_reset(e, e->game.rng, NULL);
+
+	if (obs) env_observe(e, obs);
+	if (mask) *mask = (unsigned char)game_legal_moves(&e->game);
+	return done;
+}
+
+/**
+ * Take one action in each of a number of environments.
+ */
+void env_step_batch(struct env *envs, int count, const int *actions,
+                    unsigned char *obs, unsigned long *rewards,
+                    unsigned char *dones, unsigned char *masks)
+{
+	size_t size;
+	int i, done;
+
+	if (count < 1) return;
+	size = (size_t)OBS_SIZE(envs[0].format);
+
+	for (i = 0; i < count; i++) {
+		done = env_step(&envs[i], actions[i],
+		                obs ? obs + size * (size_t)i : NULL,
+		                rewards ? rewards + i : NULL,
+		                masks ? masks + i : NULL);
+		if (dones) dones[i] = (unsigned char)done;
+	}
+}
@@ -0,0 +1,100 @@
+/**
+ * tp2 - Reinforcement Learning Environment
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef ENV_H
+#define ENV_H
+
+#include "game.h"
+
+/* Observation formats */
+#define OBS_LOG2   0 /* One byte per cell: the exponent of its value */
+#define OBS_ONEHOT 1 /* 16 planes of cells, 1 where the exponent matches */
+
+/* Size of an observation in the given format (in bytes) */
+#define OBS_SIZE(format) \
+	(((format) == OBS_ONEHOT ? 16 : 1) * BOARD_WIDTH * BOARD_HEIGHT)
+
+/**
+ * One environment: a game, plus how to restart it and
+ * how to present it to the agent.
+ */
+struct env {
+	struct game game;
+	int type;
+	int format;
+};
+
+/**
+ * Set up an environment, and start its first episode.
+ *
+ * \param[in]  e      Environment.
+ * \param[in]  type   Game type (winning exponent of 2.)
+ * \param[in]  format Observation format (OBS_*.)
+ * \param[in]  seed   Seed for the tile generator.
+ * \param[out] obs    OBS_SIZE(format) bytes for the observation (or NULL.)
+ */
+void env_init(struct env *e, int type, int format, unsigned long seed,
+              unsigned char *obs);
+
+/**
+ * Start a new episode.
+ *
+ * \param[in]  e    Environment.
+ * \param[in]  seed Seed for the tile generator.
+ * \param[out] obs  Observation (or NULL.)
+ */
+void env_reset(struct env *e, unsigned long seed, unsigned char *obs);
+
+/**
+ * Write the current observation.
+ *
+ * \param[in]  e   Environment.
+ * \param[out] obs Observation.
+ */
+void env_observe(const struct env *e, unsigned char *obs);
+
+/**
+ * Take one action.
+ *
+ * As in the game, a tile is added even if the action didn't
+ * move anything, so agents should use the mask of legal
+ * actions. When an episode ends, the environment starts the
+ * next one (continuing the tile generator's sequence), and
+ * the observation and mask are those of the new episode.
+ * Any other action (e.g. MOVE_NONE) leaves the game as it was,
+ * and scores nothing.
+ *
+ * \param[in]  e      Environment.
+ * \param[in]  action Direction to move (MOVE_*.)
+ * \param[out] obs    Observation (or NULL.)
+ * \param[out] reward Points scored by the action (or NULL.)
+ * \param[out] mask   Legal actions, as from game_legal_moves() (or NULL.)
+ * \return GAME_WON or GAME_OVER if the episode ended, 0 otherwise.
+ */
+int env_step(struct env *e, int action, unsigned char *obs,
+             unsigned long *reward, unsigned char *mask);
+
+/**
+ * Take one action in each of a number of environments.
+ *
+ * Every buffer has one entry per environment, laid out
+ * contiguously. All of the environments must use the same
+ * observation format.
+ *
+ * \param[in]  envs    Environments.
+ * \param[in]  count   Number of environments.
+ * \param[in]  actions Action for each environment.
+ * \param[out] obs     count * OBS_SIZE(format) bytes (or NULL.)
+ * \param[out] rewards Reward for each environment (or NULL.)
+ * \param[out] dones   Result of env_step() for each (or NULL.)
+ * \param[out] masks   Legal actions for each (or NULL.)
+ */
+void env_step_batch(struct env *envs, int count, const int *actions,
+                    unsigned char *obs, unsigned long *rewards,
+                    unsigned char *dones, unsigned char *masks);
+
+#endif /* ENV_H */
@@ -9,25 +9,30 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
-#include <time.h>
 #include <curses.h>
 
 #include "game.h"
-
-/* Whether the cells are free (1) or occupied (0). */
-short board_state = -1;
-
-/* Game termination state (GAME_WON or GAME_OVER.) */
-int game_state = 0;
-
-/* Game type (winning exponent of 2) */
-int game_type = 11; /* 2048 */
+#include "line.h"
+#include "tables.h"
 
 /* Number of tiles to start with */
 static int starting_tiles = 2;
 
-char board[BOARD_WIDTH * BOARD_HEIGHT];
-char score[SCORE_SIZE + 1];
+/**
+ * Get the next pseudo-random number for this game.
+ *
+ * This is the generator given as an example in the ANSI C
+ * standard, which is cheap and keeps each game's sequence
+ * independent of the others (and of the C library's.)
+ *
+ * \param[in] g Game state.
+ * \return A number between 0 and 32767.
+ */
+static int next_random(struct game *g)
+{
+	g->rng = (g->rng * 1103515245UL + 12345UL) & 0xffffffffUL;
+	return (int)((g->rng >> 16) & 0x7fff);
+}
 
 /**
  * Add a tile to a random position on the board.
@@ -36,45 +41,46 @@ char score[SCORE_SIZE + 1];
  *   "2" (90% probability)
  *   "4" (10% probability)
  * and I've preserved those odds here.
+ *
+ * \param[in] g Game state.
  */
-static void add_random_tile(void)
+static void add_random_tile(struct game *g)
 {
 	int cell;
 	int e = 1;
 
 	/* Generate the exponent for the random tile. */
-	srand((unsigned int)time(NULL));
-	if ((rand() / (double)RAND_MAX) > 0.90) e <<= 1;
+	if (next_random(g) % 10 == 9) e <<= 1;
 
 	do {
-		cell = 1 + (rand() % 15);
-		if (!(board_state & (1 << cell)))
+		cell = 1 + (next_random(g) % (BOARD_WIDTH * BOARD_HEIGHT - 1));
+		if (!(g->board_state & (1 << cell)))
 			continue;
 
 		/* Set the cell. */
-		board[cell] = (char)e;
-		board_state &= (short)~(1 << cell);
+		g->board[cell] = (char)e;
+		g->board_state &= (short)~(1 << cell);
 		break;
-	} while (board_state && board_state != 1);
+	} while (g->board_state && g->board_state != 1);
 }
 
 /**
- * Add a value to the score, updating each digit independently.
+ * Add a value to the score, one decimal digit at a time,
+ * carrying into the digit to its left.
  *
+ * \param[in] g   Game state.
  * \param[in] num value to add
  */
-static void add_to_score(unsigned int num)
+static void add_to_score(struct game *g, unsigned int num)
 {
-	int i = SCORE_SIZE - 2;
+	int i, carry = 0;
 
-	do {
-		score[i] = (char)(score[i] + (int)(num % 10));
-		if (score[i] > '9') {
-			score[i - 1]++;
-			score[i] = '0';
-		}
+	for (i = SCORE_SIZE - 2; i >= 0 && (num || carry); i--) {
+		carry += g->score[i] - '0' + (int)(num % 10);
+		g->score[i] = (char)('0' + carry % 10);
+		carry /= 10;
 		num /= 10;
-	} while (score[i - 1] != '0' && --i);
+	}
 }
 
 /**
@@ -84,22 +90,26 @@ static void add_to_score(unsigned int num)
  * This function also updates the score, and checks if the player
  * has won.
  *
+ * \param[in] g Game state.
  * \param[in] a Cell to merge into.
  * \param[in] b Cell to merge from.
  * \return 1 if the two cells were merged, 0 otherwise.
  */
-static int reduce_line(int a, int b)
+static int reduce_line(struct game *g, int a, int b)
 {
+	char *board = g->board;
 	int merged = 0;
 
 	if (board[a] == board[b]) {
 		board[a] = (board[a] + 1) & 0x0f;
 		board[b] = 0;
-		board_state |= (short)(1 << b);
+		g->board_state |= (short)(1 << b);
 
-		if (board[a] == game_type)
-			game_state = GAME_WON;
-		add_to_score((unsigned int)(4 << board[a]));
+		if (board[a] == g->game_type)
+			g->game_state = GAME_WON;
+		g->reward += (unsigned int)(4 << board[a]);
+		g->merges++;
+		add_to_score(g, (unsigned int)(4 << board[a]));
 		merged = 1;
 	}
 
@@ -110,25 +120,28 @@ static int reduce_line(int a, int b)
  * Find the next occupied cell in the line and move it
  * down.
  *
+ * \param[in] g          Game state.
  * \param[in] start      Current unoccupied cell.
  * \param[in] stride     Distance to the next cell.
  * \param[in] last_empty Last scanned empty cell on the line.
  * \return The index of the last empty cell scanned on the line.
  */
-static int shift_line(int start, int end, int stride, int last_empty)
+static int shift_line(struct game *g, int start, int end, int stride,
+                      int last_empty)
 {
+	char *board = g->board;
 	int i = (last_empty == -1) ? start : last_empty;
 
 	while (!board[start] && i != end) {
 		if (!board[i]) {
-			board_state |= (short)(1 << i);
+			g->board_state |= (short)(1 << i);
 			i += stride;
 			continue;
 		}
 
 		/* Move the next occupied cell down. */
-		board_state &= (short)~((1 << start));
-		board_state |= (short)(1 << i);
+		g->board_state &= (short)~((1 << start));
+		g->board_state |= (short)(1 << i);
 		board[start] = board[i];
 		board[i] = 0;
 	}
@@ -140,22 +153,24 @@ static int shift_line(int start, int end, int stride, int last_empty)
  * Move cells in a row or column, merging the first pair
  * of matching cells.
  *
+ * \param[in] g      Game state.
  * \param[in] start  Starting index in the board array.
  * \param[in] stride Distance to the next cell.
+ * \param[in] len    Number of cells on the line.
  */
-static void move_line(int start, int stride)
+static void move_line(struct game *g, int start, int stride, int len)
 {
-	int i = start, end = start + stride * BOARD_WIDTH;
+	int i = start, end = start + stride * len;
 	int empty = -1, matched = 0;
 
 	do {
-		if (!board[i]) {
-			empty = shift_line(i, end, stride, empty);
+		if (!g->board[i]) {
+			empty = shift_line(g, i, end, stride, empty);
 			if (empty == end) break;
 		}
 
 		if (i != start && !matched) {
-			matched = reduce_line(i - stride, i);
+			matched = reduce_line(g, i - stride, i);
 			if (matched) i -= stride;
 		}
 
@@ -164,29 +179,98 @@ static void move_line(int start, int stride)
 }
 
 /**
- * Move the whole board in a given direction.
+ * Move the whole board in the given direction, without
+ * adding a new tile, using the routines above.
  *
- * \param[in] start       Cell from which to start moving.
- * \param[in] stride      Distance to the next cell.
- * \param[in] next_stride Distance to the next line.
+ * \param[in] g         Game state.
+ * \param[in] direction One of the MOVE_* constants.
+ * \return 0 if the direction is invalid, 1 otherwise.
  */
-static void move_board(int start, int stride, int next_stride)
+static int reference_slide(struct game *g, int direction)
 {
-	int i, end = start + next_stride * BOARD_WIDTH;
+	int n, start, stride;
+
+	g->reward = 0;
+	g->merges = 0;
 
-	for (i = start; i != end; i += next_stride)
-		move_line(i, stride);
-	add_random_tile();
+	if (direction < MOVE_UP || direction > MOVE_RIGHT)
+		return 0;
+
+	for (n = 0; n < LINES(direction); n++) {
+		start = line_start(direction, n, &stride);
+		move_line(g, start, stride, LINE_LENGTH(direction));
+	}
+
+	return 1;
 }
 
+#ifdef HAVE_ROW_TABLES
+/**
+ * Move the whole board in the given direction, without
+ * adding a new tile, a line at a time from the move tables.
+ *
+ * \param[in] g         Game state.
+ * \param[in] direction One of the MOVE_* constants.
+ * \return 0 if the direction is invalid, 1 otherwise.
+ */
+static int slide_board(struct game *g, int direction)
+{
+	const unsigned short *moves = column_moves;
+	const signed char *merges = column_merges;
+	unsigned int line, moved;
+	int n, i, cell, stride;
+
+	g->reward = 0;
+	g->merges = 0;
+
+	if (direction < MOVE_UP || direction > MOVE_RIGHT)
+		return 0;
+
+	if (direction >= MOVE_LEFT) {
+		moves = row_moves;
+		merges = row_merges;
+	}
+
+	for (n = 0; n < LINES(direction); n++) {
+		cell = line_start(direction, n, &stride);
+		line = pack_line(g->board, cell, stride,
+		                 LINE_LENGTH(direction));
+		if ((moved = moves[line]) == line)
+			continue;
+
+		for (i = 0; i < LINE_LENGTH(direction); i++, moved >>= 4) {
+			g->board[cell + i * stride] = (char)(moved & 0x0f);
+			if (moved & 0x0f)
+				g->board_state &= (short)~(1 << (cell + i * stride));
+			else g->board_state |= (short)(1 << (cell + i * stride));
+		}
+
+		/* Score the merge, as reduce_line() does. */
+		if (merges[line] >= 0) {
+			if (merges[line] == g->game_type)
+				g->game_state = GAME_WON;
+			g->reward += (unsigned int)(4 << merges[line]);
+			g->merges++;
+			add_to_score(g, (unsigned int)(4 << merges[line]));
+		}
+	}
+
+	return 1;
+}
+#else
+#define slide_board reference_slide
+#endif
+
 /**
  * Check for a match across a the board, scanning right and down,
  * stopping at the first match.
  *
+ * \param[in] g Game state.
  * \return 1 if a match was found, 0 otherwise.
  */
-static int find_match(void)
+static int find_match(const struct game *g)
 {
+	const char *board = g->board;
 	int i, row = 0, matched = 0;
 
 	while (row < BOARD_WIDTH * BOARD_HEIGHT && !matched) {
@@ -200,6 +284,7 @@ static int find_match(void)
 
 			/* Check down */
 			if (!matched &&
+			    row + BOARD_WIDTH < BOARD_WIDTH * BOARD_HEIGHT &&
 			    board[row + i] == board[row + i + BOARD_WIDTH])
 				matched = 1;
 		}
@@ -214,47 +299,193 @@ static int find_match(void)
  * Initialize all memory areas used to represent
  * the game stae.
  */
-void init_game_state(void)
+void init_game_state(struct game *g, int type, unsigned long seed)
 {
 	int i;
 
-	board_state = -1;
-	game_state = 0;
-	memset(board, 0, sizeof(board));
-	memset(score, '0', SCORE_SIZE - 1);
-	score[SCORE_SIZE] = 0;
+	g->rng = seed & 0xffffffffUL;
+	g->board_state = (short)((1L << (BOARD_WIDTH * BOARD_HEIGHT)) - 1);
+	g->game_state = 0;
+	g->game_type = (unsigned char)type;
+	g->last_move = MOVE_NONE;
+	g->merges = 0;
+	g->reward = 0;
+	memset(g->board, 0, sizeof(g->board));
+	memset(g->score, '0', SCORE_SIZE - 1);
+	g->score[SCORE_SIZE - 1] = 0;
+	g->score[SCORE_SIZE] = 0;
 
 	/* Add the starting tiles */
 	for (i = 0; i < starting_tiles; i++)
-		add_random_tile();
+		add_random_tile(g);
+}
+
+/**
+ * Move the board in the given direction, add a new tile,
+ * and check for the "game over" condition.
+ */
+int game_move(struct game *g, int direction)
+{
+	char prev[BOARD_WIDTH * BOARD_HEIGHT];
+	int moved;
+
+	memcpy(prev, g->board, sizeof(prev));
+	if (!slide_board(g, direction))
+		return 0;
+
+	moved = memcmp(prev, g->board, sizeof(prev)) != 0;
+	g->last_move = (unsigned char)direction;
+	add_random_tile(g);
+
+	if (game_is_over(g))
+		g->game_state = GAME_OVER;
+	return moved;
+}
+
+/**
+ * Check whether a game is over.
+ *
+ * If the board is full, and no matches remain,
+ * the game is over.
+ */
+int game_is_over(const struct game *g)
+{
+	return (!g->board_state || g->board_state == 1) && !find_match(g);
+}
+
+/**
+ * Move the board in the given direction, without adding
+ * a new tile.
+ */
+int game_slide(struct game *g, int direction)
+{
+	char prev[BOARD_WIDTH * BOARD_HEIGHT];
+
+	memcpy(prev, g->board, sizeof(prev));
+	return slide_board(g, direction) &&
+	       memcmp(prev, g->board, sizeof(prev)) != 0;
+}
+
+/**
+ * Move the board in the given direction, without adding
+ * a new tile, using the engine's original routines.
+ */
+int game_slide_reference(struct game *g, int direction)
+{
+	char prev[BOARD_WIDTH * BOARD_HEIGHT];
+
+	memcpy(prev, g->board, sizeof(prev));
+	return reference_slide(g, direction) &&
+	       memcmp(prev, g->board, sizeof(prev)) != 0;
+}
+
+/**
+ * Place a tile on a free cell.
+ */
+void game_place_tile(struct game *g, int cell, int exponent)
+{
+	g->board[cell] = (char)exponent;
+	g->board_state &= (short)~(1 << cell);
+}
+
+/**
+ * Find out which directions would move or merge any tiles.
+ */
+int game_legal_moves(const struct game *g)
+{
+#ifdef HAVE_ROW_TABLES
+	const unsigned short *table = column_moves;
+	int i, n, cell, stride, moves = 0;
+	unsigned int line;
+
+	/* A direction is legal if it changes any line. */
+	for (i = MOVE_UP; i <= MOVE_RIGHT; i++) {
+		if (i == MOVE_LEFT) table = row_moves;
+		for (n = 0; n < LINES(i); n++) {
+			cell = line_start(i, n, &stride);
+			line = pack_line(g->board, cell, stride,
+			                 LINE_LENGTH(i));
+			if (table[line] != line) {
+				moves |= 1 << i;
+				break;
+			}
+		}
+	}
+#else
+	struct game tmp;
+	int i, moves = 0;
+
+	for (i = MOVE_UP; i <= MOVE_RIGHT; i++) {
+		tmp = *g;
+		if (game_slide(&tmp, i))
+			moves |= 1 << i;
+	}
+#endif
+
+	return moves;
+}
+
+/**
+ * Pack the board into PACKED_BOARD_SIZE bytes, two cells
+ * per byte, first cell in the high nibble.
+ */
+void game_pack_board(const struct game *g, unsigned char *out)
+{
+	int i;
+
+	memset(out, 0, PACKED_BOARD_SIZE);
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		out[i >> 1] = (unsigned char)(out[i >> 1] |
+		              (g->board[i] & 0x0f) << ((~i & 1) << 2));
+	}
+}
+
+/**
+ * Unpack a board packed by game_pack_board(), and recompute
+ * which cells are free.
+ */
+void game_unpack_board(struct game *g, const unsigned char *in)
+{
+	int i;
+
+	g->board_state = 0;
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		g->board[i] = (char)((in[i >> 1] >> ((~i & 1) << 2)) & 0x0f);
+		if (!g->board[i]) g->board_state |= (short)(1 << i);
+	}
+}
+
+/**
+ * Get the sum of the values of all tiles on the board.
+ */
+unsigned long game_tile_sum(const struct game *g)
+{
+	unsigned long sum = 0;
+	int i;
+
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++)
+		if (g->board[i]) sum += 1UL << g->board[i];
+	return sum;
 }
 
 /**
  * Handle input from the user, drive the game state,
  * and check for the "game over" condition.
  */
-void game_handle_key(int key)
+void game_handle_key(struct game *g, int key)
 {
 	switch (key) {
 	case KEY_UP:
-		move_board(0, BOARD_WIDTH, 1);
+		game_move(g, MOVE_UP);
 		break;
 	case KEY_DOWN:
-		move_board(BOARD_WIDTH * (BOARD_HEIGHT - 1),
-		           -BOARD_WIDTH, 1);
+		game_move(g, MOVE_DOWN);
 		break;
 	case KEY_LEFT:
-		move_board(0, 1, BOARD_WIDTH);
+		game_move(g, MOVE_LEFT);
 		break;
 	case KEY_RIGHT:
-		move_board(BOARD_WIDTH - 1, -1, BOARD_WIDTH);
+		game_move(g, MOVE_RIGHT);
 		break;
 	}
-
-	/**
-	 * If the board is full, and no matches remain,
-	 * the game is over.
-	 */
-	if ((!board_state || board_state == 1) && !find_match())
-		game_state = GAME_OVER;
 }
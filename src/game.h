@@ -8,11 +8,25 @@
 #ifndef GAME_H
 #define GAME_H
 
-/* Board width in tiles. */
+/**
+ * Board width in tiles.
+ *
+ * The engine handles smaller boards (e.g. -DBOARD_WIDTH=3),
+ * but the curses UI only knows how to draw a 4x4 board.
+ */
+#ifndef BOARD_WIDTH
 #define BOARD_WIDTH 4
+#endif
 
 /* Board height in tiles. */
+#ifndef BOARD_HEIGHT
 #define BOARD_HEIGHT 4
+#endif
+
+/* board_state has one bit per cell. */
+#if BOARD_WIDTH * BOARD_HEIGHT > 16
+#error "The board can't have more than 16 cells."
+#endif
 
 /* Number of digits in the score. */
 #define SCORE_SIZE 12
@@ -21,28 +35,162 @@
 #define GAME_WON  1
 #define GAME_OVER 2
 
-/* Whether the cells are free (1) or occupied (0). */
-extern short board_state;
+/* Size of a board packed by game_pack_board() (in bytes) */
+#define PACKED_BOARD_SIZE ((BOARD_WIDTH * BOARD_HEIGHT + 1) / 2)
+
+/* Directions for game_move() */
+#define MOVE_UP    0
+#define MOVE_DOWN  1
+#define MOVE_LEFT  2
+#define MOVE_RIGHT 3
+#define MOVE_NONE  4
+
+/**
+ * The state of a single game.
+ *
+ * Nothing in here refers to anything outside of the struct,
+ * so any number of games can be played side-by-side. The
+ * members are ordered largest first to avoid padding, since
+ * a host may keep thousands of these in memory.
+ */
+struct game {
+	/* State of the tile generator */
+	unsigned long rng;
+
+	/* Points scored by the last move */
+	unsigned int reward;
+
+	/* Whether the cells are free (1) or occupied (0). */
+	short board_state;
 
-/* Game termination state (GAME_WON or GAME_OVER.) */
-extern int game_state;
+	/* Game termination state (GAME_WON or GAME_OVER.) */
+	unsigned char game_state;
 
-/* Game type (winning exponent of 2) */
-extern int game_type;
+	/* Game type (winning exponent of 2) */
+	unsigned char game_type;
 
-extern char board[BOARD_WIDTH * BOARD_HEIGHT];
-extern char score[SCORE_SIZE + 1];
+	/* Last direction moved (MOVE_NONE if none yet.) */
+	unsigned char last_move;
+
+	/* Number of merges made by the last move */
+	unsigned char merges;
+
+	char board[BOARD_WIDTH * BOARD_HEIGHT];
+	char score[SCORE_SIZE + 1];
+};
 
 /**
  * Initialize all memory areas used to represent
  * the game stae.
+ *
+ * \param[in] g    Game state.
+ * \param[in] type Game type (winning exponent of 2.)
+ * \param[in] seed Seed for the tile generator.
+ */
+void init_game_state(struct game *g, int type, unsigned long seed);
+
+/**
+ * Move the board in the given direction, add a new tile,
+ * and check for the "game over" condition.
+ *
+ * \param[in] g         Game state.
+ * \param[in] direction One of the MOVE_* constants.
+ * \return 1 if any tile was moved or merged, 0 otherwise.
+ */
+int game_move(struct game *g, int direction);
+
+/**
+ * Check whether no move is left in a game, after a new tile
+ * has been added (or couldn't be.) Cell 0 never gets a new
+ * tile, so the board counts as full when only cell 0 is free.
+ *
+ * game_move() sets GAME_OVER when this is true.
+ *
+ * \param[in] g Game state.
+ * \return 1 if the game is over, 0 otherwise.
+ */
+int game_is_over(const struct game *g);
+
+/**
+ * Move the board in the given direction, without adding
+ * a new tile.
+ *
+ * \param[in] g         Game state.
+ * \param[in] direction One of the MOVE_* constants.
+ * \return 1 if any tile was moved or merged, 0 otherwise.
  */
-void init_game_state(void);
+int game_slide(struct game *g, int direction);
+
+/**
+ * Move the board in the given direction, without adding
+ * a new tile, using the engine's original routines.
+ *
+ * game_slide() may move the board another way (e.g. from the
+ * move tables), but must always give the same result as this.
+ *
+ * \param[in] g         Game state.
+ * \param[in] direction One of the MOVE_* constants.
+ * \return 1 if any tile was moved or merged, 0 otherwise.
+ */
+int game_slide_reference(struct game *g, int direction);
+
+/**
+ * Place a tile on a free cell.
+ *
+ * \param[in] g        Game state.
+ * \param[in] cell     Index of the cell.
+ * \param[in] exponent Exponent of 2 for the tile's value.
+ */
+void game_place_tile(struct game *g, int cell, int exponent);
+
+/**
+ * Find out which directions would move or merge any tiles.
+ *
+ * \param[in] g Game state.
+ * \return A mask with bit (1 << MOVE_*) set for each such direction.
+ */
+int game_legal_moves(const struct game *g);
+
+/**
+ * Pack the board into PACKED_BOARD_SIZE bytes, two cells
+ * per byte, first cell in the high nibble.
+ *
+ * Packed boards compare with memcmp() in the same order as
+ * their cells, so they can be sorted and de-duplicated as is.
+ *
+ * \param[in]  g   Game state.
+ * \param[out] out Packed board.
+ */
+void game_pack_board(const struct game *g, unsigned char *out);
+
+/**
+ * Unpack a board packed by game_pack_board(), and recompute
+ * which cells are free.
+ *
+ * \param[in] g  Game state.
+ * \param[in] in Packed board.
+ */
+void game_unpack_board(struct game *g, const unsigned char *in);
+
+/**
+ * Get the sum of the values of all tiles on the board.
+ *
+ * Merging two tiles keeps the sum as it is, and each new
+ * tile adds 2 or 4 to it, so it can be used to group boards
+ * into layers when exploring the game.
+ *
+ * \param[in] g Game state.
+ * \return The sum of all tiles.
+ */
+unsigned long game_tile_sum(const struct game *g);
 
 /**
  * Handle input from the user, drive the game state,
  * and check for the "game over" condition.
+ *
+ * \param[in] g   Game state.
+ * \param[in] key Key pressed by the user.
  */
-void game_handle_key(int key);
+void game_handle_key(struct game *g, int key);
 
 #endif /* GAME_H */
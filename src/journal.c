@@ -0,0 +1,272 @@
+/**
+ * tp2 - Move Journal
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include "game.h"
+#include "journal.h"
+
+/* Size of the writer's stdio buffer */
+#define JOURNAL_BUFFER 65536
+
+/* Longest record */
+#define RECORD_SIZE 128
+
+/**
+ * Pipe to the writer. Records are at most PIPE_BUF bytes, so
+ * each write() to it either sends a whole record, or nothing.
+ */
+static int pipe_fd = -1;
+
+/* Records that couldn't be sent */
+static unsigned long dropped = 0;
+
+/* Names of the directions */
+static const char *directions[4] = { "up", "down", "left", "right" };
+
+/* Error messages for journal_open() */
+static const char *error_messages[2] = {
+	"unable to open the journal",
+	"unable to start the journal writer"
+};
+
+/**
+ * Sync a file's data to disk.
+ *
+ * \param[in] fp File.
+ */
+static void sync_file(FILE *fp)
+{
+	fflush(fp);
+#if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+	fdatasync(fileno(fp));
+#else
+	fsync(fileno(fp));
+#endif
+}
+
+/**
+ * Copy records from the pipe to the journal, until the
+ * pipe is closed.
+ *
+ * Records are batched in a large stdio buffer, and the journal
+ * is synced once interval seconds have passed since the first
+ * record that hasn't been synced yet.
+ *
+ * \param[in] fd       Read end of the pipe.
+ * \param[in] fp       Journal.
+ * \param[in] interval Seconds between syncs.
+ */
+static void writer(int fd, FILE *fp, int interval)
+{
+	char buf[4096];
+	struct timeval tv;
+	time_t dirty = 0;
+	fd_set fds;
+	ssize_t n;
+	int ready;
+
+	/**
+	 * Keys like Ctrl + C go to the whole process group. The
+	 * writer should only stop when the game closes the pipe.
+	 */
+	signal(SIGINT, SIG_IGN);
+	signal(SIGQUIT, SIG_IGN);
+	signal(SIGHUP, SIG_IGN);
+	signal(SIGTERM, SIG_IGN);
+#ifdef SIGWINCH
+	signal(SIGWINCH, SIG_IGN);
+#endif
+
+	setvbuf(fp, NULL, _IOFBF, JOURNAL_BUFFER);
+	for (;;) {
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		tv.tv_sec = dirty ? interval : 0;
+		tv.tv_usec = 0;
+
+		ready = select(fd + 1, &fds, NULL, NULL, dirty ? &tv : NULL);
+		if (ready < 0 && errno != EINTR) break;
+
+		if (ready > 0) {
+			if ((n = read(fd, buf, sizeof(buf))) <= 0) break;
+			fwrite(buf, 1, (size_t)n, fp);
+			if (!dirty) dirty = time(NULL);
+		}
+
+		if (dirty && time(NULL) - dirty >= interval) {
+			sync_file(fp);
+			dirty = 0;
+		}
+	}
+
+	sync_file(fp);
+	fclose(fp);
+}
+
+/**
+ * Send a record to the writer, or count it as dropped.
+ *
+ * \param[in] record Record.
+ */
+static void send_record(const char *record)
+{
+	char buf[RECORD_SIZE];
+	size_t len;
+
+	if (pipe_fd < 0) return;
+
+	/* Let the journal know what it missed. */
+	if (dropped) {
+		sprintf(buf, "%ld dropped %lu\n", (long)time(NULL), dropped);
+		len = strlen(buf);
+		if (write(pipe_fd, buf, len) != (ssize_t)len) {
+			++dropped;
+			return;
+		}
+		dropped = 0;
+	}
+
+	len = strlen(record);
+	if (write(pipe_fd, record, len) != (ssize_t)len)
+		++dropped;
+}
+
+/**
+ * Journal the whole board, so that the moves that follow
+ * can be replayed from it.
+ *
+ * \param[in] g Game state.
+ */
+static void journal_game(const struct game *g)
+{
+	unsigned char packed[PACKED_BOARD_SIZE];
+	char buf[RECORD_SIZE], *p;
+	int i;
+
+	game_pack_board(g, packed);
+	p = buf + sprintf(buf, "%ld game %d board ", (long)time(NULL),
+	                  g->game_type);
+	for (i = 0; i < PACKED_BOARD_SIZE; i++)
+		p += sprintf(p, "%02x", packed[i]);
+	sprintf(p, " rng %08lx\n", g->rng);
+	send_record(buf);
+}
+
+/**
+ * Start journaling to a file.
+ */
+const char *journal_open(const char *file, int interval,
+                         const struct game *g)
+{
+	int fd[2];
+	FILE *fp;
+	pid_t pid;
+
+	if (!(fp = fopen(file, "a")))
+		return error_messages[0];
+
+	if (pipe(fd)) {
+		fclose(fp);
+		return error_messages[1];
+	}
+
+	if (!(pid = fork())) {
+		close(fd[1]);
+		writer(fd[0], fp, interval < 1 ? 1 : interval);
+		_exit(EXIT_SUCCESS);
+	}
+
+	close(fd[0]);
+	fclose(fp);
+	if (pid == -1) {
+		close(fd[1]);
+		return error_messages[1];
+	}
+
+	/* Drop records rather than wait for the writer. */
+	fcntl(fd[1], F_SETFL, fcntl(fd[1], F_GETFL) | O_NONBLOCK);
+	signal(SIGPIPE, SIG_IGN);
+	pipe_fd = fd[1];
+	dropped = 0;
+
+	journal_game(g);
+	return NULL;
+}
+
+/**
+ * Journal a key, and the move and new tile (if any) that it led to.
+ */
+void journal_key(const struct game *before, const struct game *after,
+                 int key)
+{
+	char buf[RECORD_SIZE], *p;
+	struct game slid;
+	int i;
+
+	if (pipe_fd < 0) return;
+
+	/* A new game */
+	if (after->last_move == MOVE_NONE && after->rng != before->rng) {
+		journal_game(after);
+		return;
+	}
+
+	p = buf + sprintf(buf, "%ld key %d", (long)time(NULL), key);
+
+	/* Every move adds a tile, so the generator moves on. */
+	if (after->rng != before->rng && after->last_move < MOVE_NONE) {
+		slid = *before;
+		p += sprintf(p, " move %s moved %d",
+		             directions[after->last_move],
+		             game_slide(&slid, after->last_move));
+
+		/* The new tile is on the only cell that differs. */
+		for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+			if (slid.board[i] != after->board[i]) {
+				p += sprintf(p, " spawn %d %d", i,
+				             after->board[i]);
+				break;
+			}
+		}
+
+		p += sprintf(p, " score %s", after->score);
+		if (after->game_state) {
+			p += sprintf(p, " %s", after->game_state == GAME_WON ?
+			                       "won" : "over");
+		}
+	}
+
+	strcpy(p, "\n");
+	send_record(buf);
+}
+
+/**
+ * Stop journaling.
+ */
+unsigned long journal_close(void)
+{
+	unsigned long n = dropped;
+
+	if (pipe_fd >= 0) {
+		close(pipe_fd);
+		pipe_fd = -1;
+	}
+
+	dropped = 0;
+	return n;
+}
@@ -0,0 +1,46 @@
+/**
+ * tp2 - Move Journal
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+struct game;
+
+/**
+ * Start journaling to a file.
+ *
+ * The file is written by a separate process, which syncs it to
+ * disk at most every interval seconds, and keeps what it was sent
+ * even if this process dies. Journaling never waits on the disk:
+ * if the writer falls behind, records are dropped and counted.
+ *
+ * \param[in] file     File to append the journal to.
+ * \param[in] interval Seconds between syncs.
+ * \param[in] g        Game state at the start.
+ * \return NULL on success, error message on error.
+ */
+const char *journal_open(const char *file, int interval,
+                         const struct game *g);
+
+/**
+ * Journal a key, and the move and new tile (if any) that it led to.
+ *
+ * \param[in] before Game state before the key was handled.
+ * \param[in] after  Game state after the key was handled.
+ * \param[in] key    Key pressed by the user.
+ */
+void journal_key(const struct game *before, const struct game *after,
+                 int key);
+
+/**
+ * Stop journaling. The writer finishes on its own.
+ *
+ * \return The number of records dropped.
+ */
+unsigned long journal_close(void);
+
+#endif /* JOURNAL_H */
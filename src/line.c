@@ -0,0 +1,80 @@
+/**
+ * tp2 - Packed Line Moves
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include "line.h"
+
+/**
+ * Move a packed line of cells towards its first cell, merging
+ * the first pair of matching cells, exactly as move_line() does
+ * on the board.
+ *
+ * The tiles are gathered in order, the first matching pair is
+ * merged, and the rest are gathered after it. Like move_line(),
+ * a merge that overflows the exponent leaves an empty cell in
+ * place of the merged tile.
+ */
+unsigned int line_move(unsigned int line, int len, int *merged)
+{
+	unsigned int out = 0, c, prev = 0;
+	int i, n = 0;
+
+	*merged = -1;
+	for (i = 0; i < len; i++) {
+		if (!(c = (line >> (i << 2)) & 0x0f))
+			continue;
+
+		if (*merged == -1 && n && c == prev) {
+			c = (c + 1) & 0x0f;
+			*merged = (int)c;
+			out &= ~(0x0fU << ((n - 1) << 2));
+			out |= c << ((n - 1) << 2);
+			continue;
+		}
+
+		out |= c << (n << 2);
+		prev = c;
+		n++;
+	}
+
+	return out;
+}
+
+/**
+ * Find the first cell of a line moving in the given direction,
+ * and the distance to the next cell on it.
+ */
+int line_start(int direction, int n, int *stride)
+{
+	switch (direction) {
+	case MOVE_UP:
+		*stride = BOARD_WIDTH;
+		return n;
+	case MOVE_DOWN:
+		*stride = -BOARD_WIDTH;
+		return BOARD_WIDTH * (BOARD_HEIGHT - 1) + n;
+	case MOVE_LEFT:
+		*stride = 1;
+		return BOARD_WIDTH * n;
+	}
+
+	*stride = -1;
+	return BOARD_WIDTH * n + BOARD_WIDTH - 1;
+}
+
+/**
+ * Pack a line of cells from the board.
+ */
+unsigned int pack_line(const char *board, int cell, int stride, int len)
+{
+	unsigned int line = 0;
+	int i;
+
+	for (i = 0; i < len; i++, cell += stride)
+		line |= (unsigned int)(board[cell] & 0x0f) << (i << 2);
+	return line;
+}
@@ -0,0 +1,59 @@
+/**
+ * tp2 - Packed Line Moves
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef LINE_H
+#define LINE_H
+
+#include "game.h"
+
+/* Number of cells on a line moving in the given direction */
+#define LINE_LENGTH(dir) \
+	((dir) >= MOVE_LEFT ? BOARD_WIDTH : BOARD_HEIGHT)
+
+/* Number of lines moving in the given direction */
+#define LINES(dir) \
+	((dir) >= MOVE_LEFT ? BOARD_HEIGHT : BOARD_WIDTH)
+
+/**
+ * Move a packed line of cells towards its first cell, merging
+ * the first pair of matching cells, exactly as move_line() does
+ * on the board.
+ *
+ * Cell n of the line is held in bits 4n - 4n + 3 of the packed
+ * line, so a line of 4 cells fits in 16 bits.
+ *
+ * \param[in]  line   Packed line.
+ * \param[in]  len    Number of cells in the line.
+ * \param[out] merged Exponent of the merged cell, or -1 if no
+ *                    cells were merged.
+ * \return The packed line after the move.
+ */
+unsigned int line_move(unsigned int line, int len, int *merged);
+
+/**
+ * Find the first cell of a line moving in the given direction,
+ * and the distance to the next cell on it.
+ *
+ * \param[in]  direction One of the MOVE_* constants.
+ * \param[in]  n         Index of the line.
+ * \param[out] stride    Distance to the next cell.
+ * \return The index of the first cell.
+ */
+int line_start(int direction, int n, int *stride);
+
+/**
+ * Pack a line of cells from the board, as line_move() expects.
+ *
+ * \param[in] board  Cells.
+ * \param[in] cell   First cell of the line.
+ * \param[in] stride Distance to the next cell.
+ * \param[in] len    Number of cells on the line.
+ * \return The packed line.
+ */
+unsigned int pack_line(const char *board, int cell, int stride, int len);
+
+#endif /* LINE_H */
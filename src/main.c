@@ -10,26 +10,98 @@
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <time.h>
 #include <curses.h>
 
 #include "ui.h"
 #include "game.h"
+#include "autoplay.h"
+#include "save.h"
 
 #ifndef PDCURSES
 #include "terminal.h"
+#include "spectator.h"
+#include "tournament.h"
+#include "check.h"
+#include "journal.h"
+#include "server.h"
 #endif
 
 /* Signal flags (see terminal.c) */
 volatile sig_atomic_t got_signal = 0;
 volatile sig_atomic_t got_winch = 0;
 
+/* The game being played */
+static struct game game;
+
+/* Autoplay rate in moves/sec (0 = no limit, -1 = off), and games */
+static long autoplay_rate = -1;
+static int autoplay_count = 1;
+
+/* File to resume from, and save to on exit (-r) */
+static const char *save_file = NULL;
+
+/* File to write autoplay statistics to (-s) */
+static const char *stats_file = NULL;
+
+#ifndef PDCURSES
+/* Shared memory keys for publishing / watching a game (-p / -w) */
+static long publish_key = 0;
+static long watch_key = 0;
+
+/* Games per policy, and worker processes, for a tournament (-T / -j) */
+static int tournament_games = 0;
+static int tournament_workers = 1;
+
+/* Weights of an n-tuple network to add to the tournament (-W) */
+static const char *weights_file = NULL;
+
+/* Random boards to check the move kernels against (-C) */
+static long check_cases = -1;
+
+/* File to journal moves to, and seconds between syncs (-J / -F) */
+static const char *journal_file = NULL;
+static int journal_interval = 1;
+
+/* Socket to serve games on (-S), or to play a served game through (-c) */
+static const char *server_path = NULL;
+static const char *client_path = NULL;
+#endif
+
 /**
  * Show usage information.
  */
 static void usage(char *argv0)
 {
-	printf("Usage: %s [-t game_type] [-b]\n", argv0);
+#ifndef PDCURSES
+	printf("Usage: %s [-t game_type] [-b] [-a rate] [-n games] "
+	       "[-r file] [-s file] [-p key | -w key] [-J file [-F secs]] "
+	       "[-T games [-W file] | -C cases [-j workers]] "
+	       "[-S socket | -c socket]\n",
+	       argv0);
+#else
+	printf("Usage: %s [-t game_type] [-b] [-a rate] [-n games] "
+	       "[-r file] [-s file]\n", argv0);
+#endif
+	puts("\t-a rate:      Autoplay at rate moves/sec (0 = no limit)");
 	puts("\t-b:           Black & white mode");
+	puts("\t-n games:     Number of games to autoplay (1 - 64)");
+#ifndef PDCURSES
+	puts("\t-p key:       Publish the game to shared memory");
+	puts("\t-w key:       Watch a game published with -p key");
+	puts("\t-J file:      Journal keys, moves and new tiles to file");
+	puts("\t-F secs:      Seconds between journal syncs (default: 1)");
+	puts("\t-T games:     Compare the built-in policies over games");
+	puts("\t-W file:      Add the n-tuple network in file (see tp2-train)");
+	puts("\t              to -T");
+	puts("\t-C cases:     Check the move kernels on every line, and on");
+	puts("\t              cases random boards");
+	puts("\t-j workers:   Number of processes for -T or -C (default: 1)");
+	puts("\t-S socket:    Serve games to clients on a Unix domain socket");
+	puts("\t-c socket:    Play a game served with -S socket");
+#endif
+	puts("\t-r file:      Resume from file, and save to it on exit");
+	puts("\t-s file:      Append autoplay statistics to file");
 	puts("\t-t game_type: Set the game type.\n");
 	puts("\t  The game type signfies the exponent of");
 	puts("\t  2 you have to reach to win the game. It");
@@ -37,10 +109,39 @@ static void usage(char *argv0)
 	puts("\t  and the default value is 11 [2048].\n");
 }
 
+/**
+ * Resume the game(s) saved in save_file, if it exists.
+ *
+ * \return NULL on success, error message on error.
+ */
+static const char *resume(void)
+{
+	const char *err = NULL;
+	FILE *fp;
+	int i;
+
+	if (!save_file || !(fp = fopen(save_file, "rb")))
+		return NULL;
+	fclose(fp);
+
+	if (autoplay_rate < 0)
+		return load_game(save_file, 0, &game);
+
+	/* Having saved fewer games than we're playing is fine. */
+	for (i = 0; i < autoplay_count; i++)
+		if ((err = load_game(save_file, i, autoplay_game(i))))
+			break;
+	return i && load_game_missing(err) ? NULL : err;
+}
+
 int main(int argc, char *argv[])
 {
 	const char *err = NULL;
-	int i, retval, key;
+	int i, retval, key, redraw = 0, type = 11; /* 2048 */
+#ifndef PDCURSES
+	struct game prev;
+	unsigned long dropped;
+#endif
 
 	/* Handle args */
 	for (i = 1; i < argc; i++) {
@@ -55,13 +156,109 @@ int main(int argc, char *argv[])
 					err = "game type must be between 10 and 15.";
 					goto err;
 				}
-				game_type = key & 0x0f;
+				type = key & 0x0f;
+				++i;
+			}
+			break;
+		case 'a': /* -a: Autoplay at the given rate */
+			if (i + 1 < argc) {
+				autoplay_rate = atol(argv[i + 1]);
+				if (autoplay_rate < 0) {
+					err = "the autoplay rate can't be negative.";
+					goto err;
+				}
 				++i;
 			}
 			break;
 		case 'b': /* -b: Black & White mode (i.e. don't use colors) */
 			colors = 0;
 			break;
+		case 'r': /* -r: Resume from / save to a file */
+			if (i + 1 < argc) save_file = argv[++i];
+			break;
+		case 's': /* -s: Autoplay statistics file */
+			if (i + 1 < argc) stats_file = argv[++i];
+			break;
+		case 'n': /* -n: Number of games to autoplay */
+			if (i + 1 < argc) {
+				autoplay_count = atoi(argv[i + 1]);
+				if (autoplay_count < 1 ||
+				    autoplay_count > AUTOPLAY_MAX) {
+					err = "the number of games must be between 1 and 64.";
+					goto err;
+				}
+				++i;
+			}
+			break;
+#ifndef PDCURSES
+		case 'p': /* -p: Publish the game for spectators */
+		case 'w': /* -w: Watch a published game */
+			if (i + 1 < argc) {
+				if (!(publish_key = atol(argv[i + 1]))) {
+					err = "the key must be a non-zero number.";
+					goto err;
+				}
+				if (argv[i][1] == 'w') {
+					watch_key = publish_key;
+					publish_key = 0;
+				}
+				++i;
+			}
+			break;
+		case 'T': /* -T: Play a tournament */
+			if (i + 1 < argc) {
+				tournament_games = atoi(argv[i + 1]);
+				if (tournament_games < 1) {
+					err = "the number of games must be positive.";
+					goto err;
+				}
+				++i;
+			}
+			break;
+		case 'W': /* -W: N-tuple network for the tournament */
+			if (i + 1 < argc) weights_file = argv[++i];
+			break;
+		case 'J': /* -J: Journal file */
+			if (i + 1 < argc) journal_file = argv[++i];
+			break;
+		case 'F': /* -F: Seconds between journal syncs */
+			if (i + 1 < argc) {
+				journal_interval = atoi(argv[i + 1]);
+				if (journal_interval < 1) {
+					err = "the sync interval must be at least 1 second.";
+					goto err;
+				}
+				++i;
+			}
+			break;
+		case 'C': /* -C: Check the move kernels */
+			if (i + 1 < argc) {
+				check_cases = atol(argv[i + 1]);
+				if (check_cases < 0) {
+					err = "the number of cases can't be negative.";
+					goto err;
+				}
+				++i;
+			}
+			break;
+		case 'j': /* -j: Worker processes for the tournament / check */
+			if (i + 1 < argc) {
+				tournament_workers = atoi(argv[i + 1]);
+				if (tournament_workers < 1 ||
+				    tournament_workers > TOURNAMENT_MAX_WORKERS) {
+					err = "the number of workers must be between 1 and 64.";
+					goto err;
+				}
+				++i;
+			}
+			break;
+		case 'S': /* -S: Serve games */
+			if (i + 1 < argc) server_path = argv[++i];
+			break;
+		case 'c': /* -c: Play a served game */
+			if (i + 1 < argc) client_path = argv[++i];
+			break;
+#endif
 		default:
 			usage(argv[0]);
 			goto err;
@@ -69,12 +266,75 @@ int main(int argc, char *argv[])
 	}
 
 #ifndef PDCURSES
+	/* Tournaments don't need the UI. */
+	if (tournament_games) {
+		err = tournament_run(tournament_games, tournament_workers,
+		                     type, weights_file);
+		goto err;
+	}
+
+	/* Neither does checking the move kernels. */
+	if (check_cases >= 0) {
+		err = check_run((unsigned long)check_cases,
+		                tournament_workers);
+		goto err;
+	}
+
+	/* Serving games doesn't need the UI. */
+	if (server_path) {
+		err = server_run(server_path);
+		goto err;
+	}
+
+	/* Spectators only watch, and clients play the server's game. */
+	if (watch_key) client_path = NULL;
+	if (watch_key || client_path) {
+		autoplay_rate = -1;
+		save_file = NULL;
+		journal_file = NULL;
+	}
+#endif
+
+	init_game_state(&game, type, (unsigned long)time(NULL));
+	if (autoplay_rate >= 0)
+		autoplay_init(autoplay_count, type, game.rng, autoplay_rate);
+
+	if ((err = resume())) goto err;
+	type = game.game_type;
+
+	if (autoplay_rate >= 0 && stats_file &&
+	    (err = autoplay_stats(stats_file)))
+		goto err;
+
+#ifndef PDCURSES
+	/* Only the keys of a game being played are journaled. */
+	if (journal_file && autoplay_rate < 0 &&
+	    (err = journal_open(journal_file, journal_interval, &game)))
+		goto err;
+
+	if (client_path && ((err = client_connect(client_path)) ||
+	    (err = client_request(&game, SERVER_NEW, type))))
+		goto err;
+
+	if (watch_key) err = spectator_watch(watch_key);
+	else if (publish_key) err = spectator_publish(publish_key);
+	if (err) goto err;
+
 	err = term_init();
 	if (err) goto err;
+
+	if (watch_key) spectator_read(&game);
+	else spectator_update(&game);
 #endif
 
-	init_game_state();
-	ui_init();
+	if (autoplay_rate >= 0)
+		ui_init(NULL);
+	else ui_init(&game);
+
+#ifndef PDCURSES
+	/* Spectators poll for new states, rather than wait for keys. */
+	if (watch_key) timeout(100);
+#endif
 
 	/* Render the UI and feed input into the game logic. */
 	while (!got_signal) {
@@ -91,9 +351,32 @@ int main(int argc, char *argv[])
 			erase();
 #endif
 			ui_window_size_changed();
+			redraw = 1;
 		}
 
-		ui_render_game_state();
+		if (autoplay_rate >= 0) {
+			autoplay_frame();
+			autoplay_render();
+
+			/**
+			 * Waiting for a key paces the frames, unless
+			 * we're playing as fast as we can.
+			 */
+			timeout(autoplay_timeout());
+#ifndef PDCURSES
+			spectator_update(autoplay_game(0));
+#endif
+		} else {
+#ifndef PDCURSES
+			/* Spectators only redraw when there's a new state. */
+			if (watch_key) redraw |= spectator_read(&game);
+			else
+#endif
+			redraw = 1;
+
+			if (redraw) ui_render_game_state(&game);
+		}
+		redraw = 0;
 		if ((key = getch()) == ERR) continue;
 
 		/* PDCurses / xpg4 curses send ETX on Ctrl + C. */
@@ -106,9 +389,28 @@ int main(int argc, char *argv[])
 		}
 #endif
 
+		if (autoplay_rate >= 0) continue;
+#ifndef PDCURSES
+		if (watch_key) continue;
+
+		/* The server plays the game, and sends back the result. */
+		if (client_path) {
+			if ((err = client_handle_key(&game, key))) break;
+			spectator_update(&game);
+			continue;
+		}
+
+		prev = game;
+#endif
+
 		/* Allow the user to restart when 'r' is pressed. */
-		if (!game_state) game_handle_key(key);
-		else if (key == 'r') init_game_state();
+		if (!game.game_state) game_handle_key(&game, key);
+		else if (key == 'r') init_game_state(&game, type, game.rng);
+
+#ifndef PDCURSES
+		journal_key(&prev, &game, key);
+		spectator_update(&game);
+#endif
 	}
 	ui_uninit();
 
@@ -116,7 +418,25 @@ int main(int argc, char *argv[])
 	term_uninit();
 #endif
 
+	if (autoplay_rate >= 0)
+		autoplay_uninit();
+
+	if (save_file) {
+		if (autoplay_rate >= 0)
+			err = save_games(save_file, autoplay_game(0),
+			                 autoplay_count);
+		else err = save_games(save_file, &game, 1);
+	}
+
 err:
+#ifndef PDCURSES
+	spectator_uninit();
+	client_disconnect();
+	if ((dropped = journal_close()))
+		fprintf(stderr, "warning: %lu journal records were dropped.\n",
+		        dropped);
+#endif
+
 	/* If we have an error message, print it */
 	if (err) {
 		fprintf(stderr, "error: %s\n", err);
@@ -0,0 +1,129 @@
+/**
+ * tp2 - N-tuple Networks
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include "game.h"
+#include "ntuple.h"
+
+#if BOARD_WIDTH == 4 && BOARD_HEIGHT == 4
+
+/* Number of rotations and reflections of the board */
+#define SYMMETRIES 8
+
+/* Cells of each tuple, on the board as it is */
+static const unsigned char tuples[NTUPLES][NTUPLE_SIZE] = {
+	{ 0, 1, 2,  3, 4, 5 },
+	{ 4, 5, 6,  7, 8, 9 },
+	{ 0, 1, 2,  4, 5, 6 },
+	{ 4, 5, 6,  8, 9, 10 }
+};
+
+/* Cells of each tuple, in each symmetry of the board */
+static unsigned char cells[SYMMETRIES][NTUPLES][NTUPLE_SIZE];
+static int have_cells = 0;
+
+/**
+ * Work out where each tuple's cells are in every symmetry
+ * of the board.
+ */
+static void find_cells(void)
+{
+	int s, t, i, k, r, c, n;
+
+	for (s = 0; s < SYMMETRIES; s++) {
+		for (t = 0; t < NTUPLES; t++) {
+			for (i = 0; i < NTUPLE_SIZE; i++) {
+				r = tuples[t][i] / 4;
+				c = tuples[t][i] % 4;
+
+				/* Reflect, then rotate a quarter turn at a time. */
+				if (s & 4) c = 3 - c;
+				for (k = s & 3; k; k--) {
+					n = c;
+					c = 3 - r;
+					r = n;
+				}
+
+				cells[s][t][i] = (unsigned char)(r * 4 + c);
+			}
+		}
+	}
+
+	have_cells = 1;
+}
+
+/**
+ * Find the weight for one tuple in one symmetry of a board.
+ *
+ * \param[in] g Game state.
+ * \param[in] s Symmetry.
+ * \param[in] t Tuple.
+ * \return Index of the weight.
+ */
+static unsigned long weight_index(const struct game *g, int s, int t)
+{
+	const unsigned char *cell = cells[s][t];
+	unsigned long i = 0;
+	int k;
+
+	for (k = NTUPLE_SIZE - 1; k >= 0; k--)
+		i = (i << 4) | (unsigned long)(g->board[cell[k]] & 0x0f);
+	return (unsigned long)t * NTUPLE_TABLE + i;
+}
+
+/**
+ * Value a board.
+ */
+float ntuple_value(const float *w, const struct game *g)
+{
+	float v = 0.0f;
+	int s, t;
+
+	if (!have_cells) find_cells();
+	for (s = 0; s < SYMMETRIES; s++)
+		for (t = 0; t < NTUPLES; t++)
+			v += w[weight_index(g, s, t)];
+	return v;
+}
+
+/**
+ * Add to every weight that values a board.
+ */
+void ntuple_update(float *w, const struct game *g, float delta)
+{
+	int s, t;
+
+	if (!have_cells) find_cells();
+	for (s = 0; s < SYMMETRIES; s++)
+		for (t = 0; t < NTUPLES; t++)
+			w[weight_index(g, s, t)] += delta;
+}
+
+#else
+
+/**
+ * Value a board (only 4x4 boards are supported.)
+ */
+float ntuple_value(const float *w, const struct game *g)
+{
+	(void)w;
+	(void)g;
+	return 0.0f;
+}
+
+/**
+ * Add to every weight that values a board (only 4x4 boards
+ * are supported.)
+ */
+void ntuple_update(float *w, const struct game *g, float delta)
+{
+	(void)w;
+	(void)g;
+	(void)delta;
+}
+
+#endif
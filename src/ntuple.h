@@ -0,0 +1,52 @@
+/**
+ * tp2 - N-tuple Networks
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef NTUPLE_H
+#define NTUPLE_H
+
+/**
+ * An n-tuple network values a board by looking up the tiles
+ * under each tuple of cells in a table of weights, and adding
+ * up what it finds.
+ *
+ * The network has four 6-tuples (two rows with two cells of the
+ * row below, and two 2x3 rectangles), each looked up in all 8
+ * rotations and reflections of the board, which share its table.
+ * Each cell is 4 bits, so a table has 16^6 weights.
+ *
+ * Networks only work on a 4x4 board. On others, ntuple_value()
+ * is always 0, and ntuple_update() does nothing.
+ */
+#define NTUPLES       4
+#define NTUPLE_SIZE   6
+#define NTUPLE_TABLE  (1UL << (4 * NTUPLE_SIZE))
+
+/* Number of weights in a network */
+#define NTUPLE_WEIGHTS (NTUPLES * NTUPLE_TABLE)
+
+struct game;
+
+/**
+ * Value a board.
+ *
+ * \param[in] w Weights (NTUPLE_WEIGHTS of them.)
+ * \param[in] g Game state.
+ * \return The value.
+ */
+float ntuple_value(const float *w, const struct game *g);
+
+/**
+ * Add to every weight that values a board, moving its value
+ * by NTUPLES * 8 times as much.
+ *
+ * \param[in] w     Weights.
+ * \param[in] g     Game state.
+ * \param[in] delta Amount to add to each weight.
+ */
+void ntuple_update(float *w, const struct game *g, float delta);
+
+#endif /* NTUPLE_H */
@@ -0,0 +1,277 @@
+/**
+ * tp2 - Move Selection Policies
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+
+#include "game.h"
+#include "ntuple.h"
+#include "tablebase.h"
+#include "policy.h"
+
+/* Value of a free cell when evaluating a board */
+#define FREE_CELL_VALUE 16L
+
+/* Maximum number of moves in a Monte Carlo playout */
+#define PLAYOUT_LENGTH 32
+
+static long max_node(const struct game *g, int depth);
+
+/**
+ * Get the next pseudo-random number for this policy.
+ *
+ * \param[in] p Policy.
+ * \return A number between 0 and 32767.
+ */
+static int next_random(struct policy *p)
+{
+	p->rng = (p->rng * 1103515245UL + 12345UL) & 0xffffffffUL;
+	return (int)((p->rng >> 16) & 0x7fff);
+}
+
+/**
+ * Pick one of the directions in a mask at random.
+ *
+ * \param[in] p     Policy.
+ * \param[in] moves Mask of legal moves.
+ * \return The direction.
+ */
+static int random_move(struct policy *p, int moves)
+{
+	int i, n = 0, choice;
+
+	for (i = MOVE_UP; i <= MOVE_RIGHT; i++)
+		if (moves & (1 << i)) n++;
+	if (!n) return MOVE_UP;
+
+	choice = next_random(p) % n;
+	for (i = MOVE_UP; i <= MOVE_RIGHT; i++)
+		if ((moves & (1 << i)) && !choice--)
+			break;
+	return i;
+}
+
+/**
+ * Count the free cells on the board.
+ *
+ * \param[in] g Game state.
+ * \return The number of free cells.
+ */
+static long free_cells(const struct game *g)
+{
+	long n = 0;
+	int i;
+
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++)
+		if (!g->board[i]) n++;
+	return n;
+}
+
+/**
+ * Average the value of a board over every tile the game
+ * could add to it.
+ *
+ * Tiles are never added to cell 0 (see add_random_tile().)
+ * If there's nowhere to add one, the game goes on from the
+ * board as it is.
+ *
+ * \param[in] g     Game state (after a move.)
+ * \param[in] depth Moves left to search.
+ * \return The expected value.
+ */
+static long chance_node(const struct game *g, int depth)
+{
+	struct game tmp;
+	long sum = 0, n = 0;
+	int i;
+
+	for (i = 1; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		if (g->board[i]) continue;
+
+		tmp = *g;
+		game_place_tile(&tmp, i, 1);
+		sum += 9 * max_node(&tmp, depth);
+
+		tmp = *g;
+		game_place_tile(&tmp, i, 2);
+		sum += max_node(&tmp, depth);
+		n += 10;
+	}
+
+	if (!n && (sum = tablebase_probe(g)) >= 0)
+		return sum;
+	return n ? sum / n : free_cells(g) * FREE_CELL_VALUE;
+}
+
+/**
+ * Find the value of the best move from a board.
+ *
+ * A board in the tablebase is worth its chance of winning,
+ * with no need to search any further.
+ *
+ * \param[in] g     Game state.
+ * \param[in] depth Moves left to search.
+ * \return The value of the best move, or 0 if there's none.
+ */
+static long max_node(const struct game *g, int depth)
+{
+	struct game tmp;
+	long v, best = 0;
+	int i;
+
+	if ((v = tablebase_probe(g)) >= 0)
+		return v;
+
+	for (i = MOVE_UP; i <= MOVE_RIGHT; i++) {
+		tmp = *g;
+		if (!game_slide(&tmp, i)) continue;
+
+		v = (long)tmp.reward;
+		if (depth > 1) v += chance_node(&tmp, depth - 1);
+		else v += free_cells(&tmp) * FREE_CELL_VALUE;
+		if (v > best) best = v;
+	}
+
+	return best;
+}
+
+/**
+ * Choose the legal move with the highest value.
+ *
+ * For the greedy policy, a move's value is the points it scores
+ * plus the free cells it leaves. For expectimax, it's searched
+ * depth moves deep, unless the tablebase covers the game: then
+ * it's the chance of winning after the move, from the tablebase.
+ *
+ * \param[in] p     Policy.
+ * \param[in] g     Game state.
+ * \param[in] moves Mask of legal moves.
+ * \return The direction.
+ */
+static int best_move(struct policy *p, const struct game *g, int moves)
+{
+	struct game tmp;
+	long v, best = -1;
+	int i, move = random_move(p, moves);
+	int exact = p->type == POLICY_EXPECTIMAX && tablebase_covers(g);
+
+	for (i = MOVE_UP; i <= MOVE_RIGHT; i++) {
+		if (!(moves & (1 << i))) continue;
+
+		tmp = *g;
+		game_slide(&tmp, i);
+		if (exact) {
+			v = chance_node(&tmp, 1);
+		} else {
+			v = (long)tmp.reward;
+			if (p->type == POLICY_EXPECTIMAX && p->depth > 1)
+				v += chance_node(&tmp, p->depth - 1);
+			else v += free_cells(&tmp) * FREE_CELL_VALUE;
+		}
+
+		if (v > best) {
+			best = v;
+			move = i;
+		}
+	}
+
+	return move;
+}
+
+/**
+ * Choose the legal move whose random playouts score the
+ * most points on average.
+ *
+ * The playouts draw their tiles from the policy's generator,
+ * so that they can't see which tiles the game will add.
+ *
+ * \param[in] p     Policy.
+ * \param[in] g     Game state.
+ * \param[in] moves Mask of legal moves.
+ * \return The direction.
+ */
+static int montecarlo_move(struct policy *p, const struct game *g,
+                           int moves)
+{
+	struct game tmp;
+	long v, best = -1;
+	int i, j, k, move = random_move(p, moves);
+
+	for (i = MOVE_UP; i <= MOVE_RIGHT; i++) {
+		if (!(moves & (1 << i))) continue;
+
+		for (j = 0, v = 0; j < p->depth; j++) {
+			tmp = *g;
+			tmp.rng = p->rng ^ (unsigned long)next_random(p);
+			game_move(&tmp, i);
+			v += (long)tmp.reward;
+
+			for (k = 0; k < PLAYOUT_LENGTH && !tmp.game_state; k++) {
+				game_move(&tmp, random_move(p,
+				          game_legal_moves(&tmp)));
+				v += (long)tmp.reward;
+			}
+		}
+
+		if (v > best) {
+			best = v;
+			move = i;
+		}
+	}
+
+	return move;
+}
+
+/**
+ * Choose the legal move whose points, plus the value of the
+ * board it leaves (before a tile is added), are highest.
+ *
+ * \param[in] p     Policy.
+ * \param[in] g     Game state.
+ * \param[in] moves Mask of legal moves.
+ * \return The direction.
+ */
+static int ntuple_move(struct policy *p, const struct game *g, int moves)
+{
+	struct game tmp;
+	float v, best = 0.0f;
+	int i, move = -1;
+
+	for (i = MOVE_UP; i <= MOVE_RIGHT; i++) {
+		if (!(moves & (1 << i))) continue;
+
+		tmp = *g;
+		game_slide(&tmp, i);
+		v = (float)tmp.reward + ntuple_value(p->weights, &tmp);
+		if (move < 0 || v > best) {
+			best = v;
+			move = i;
+		}
+	}
+
+	return move < 0 ? random_move(p, moves) : move;
+}
+
+/**
+ * Choose a move.
+ */
+int policy_move(struct policy *p, const struct game *g)
+{
+	int moves = game_legal_moves(g);
+
+	switch (p->type) {
+	case POLICY_GREEDY:
+	case POLICY_EXPECTIMAX:
+		return best_move(p, g, moves);
+	case POLICY_MONTECARLO:
+		return montecarlo_move(p, g, moves);
+	case POLICY_NTUPLE:
+		return ntuple_move(p, g, moves);
+	}
+
+	return random_move(p, moves);
+}
@@ -0,0 +1,45 @@
+/**
+ * tp2 - Move Selection Policies
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef POLICY_H
+#define POLICY_H
+
+/* Policy types */
+#define POLICY_RANDOM     0 /* Any legal move */
+#define POLICY_GREEDY     1 /* The move scoring the most points */
+#define POLICY_EXPECTIMAX 2 /* Expectimax search, depth moves deep */
+#define POLICY_MONTECARLO 3 /* depth random playouts per move */
+#define POLICY_NTUPLE     4 /* The best move, valued by weights */
+
+struct game;
+
+/**
+ * A policy, and its own random number generator, which is
+ * kept separate from the game's, so that the policy doesn't
+ * affect which tiles the game adds.
+ *
+ * POLICY_NTUPLE values boards with the n-tuple network in
+ * weights (see ntuple.h.)
+ */
+struct policy {
+	const char *name;
+	int type;
+	int depth;
+	unsigned long rng;
+	const float *weights;
+};
+
+/**
+ * Choose a move.
+ *
+ * \param[in] p Policy.
+ * \param[in] g Game state.
+ * \return The direction to move (MOVE_*.)
+ */
+int policy_move(struct policy *p, const struct game *g);
+
+#endif /* POLICY_H */
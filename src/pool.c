@@ -0,0 +1,120 @@
+/**
+ * tp2 - Object Pools
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+/* Start of a chunk, aligned for any object that follows it */
+union chunk {
+	void *next;
+	long l;
+	double d;
+};
+
+/**
+ * Find the first object in a chunk.
+ *
+ * \param[in] c Chunk.
+ * \return The object.
+ */
+static char *first_object(void *c)
+{
+	return (char *)((union chunk *)c + 1);
+}
+
+/**
+ * Set up an empty pool.
+ */
+void pool_init(struct pool *p, size_t size, size_t per_chunk)
+{
+	memset(p, 0, sizeof(*p));
+
+	/* Free objects hold the link to the next one. */
+	if (size < sizeof(void *)) size = sizeof(void *);
+	p->size = (size + sizeof(union chunk) - 1) / sizeof(union chunk) *
+	          sizeof(union chunk);
+	p->per_chunk = per_chunk ? per_chunk : 1;
+}
+
+/**
+ * Get an object from a pool.
+ */
+void *pool_get(struct pool *p)
+{
+	union chunk *c;
+	void *obj;
+
+	if (p->free_list) {
+		obj = p->free_list;
+		p->free_list = *(void **)obj;
+	} else {
+		/* Move on to the next chunk, allocating it if need be. */
+		if (!p->chunk || p->used == p->per_chunk) {
+			c = p->chunk ? ((union chunk *)p->chunk)->next : p->chunks;
+			if (!c) {
+				if (!(c = malloc(sizeof(*c) +
+				                 p->size * p->per_chunk)))
+					return NULL;
+				c->next = NULL;
+				if (p->chunk) ((union chunk *)p->chunk)->next = c;
+				else p->chunks = c;
+				p->stats.chunks++;
+				p->stats.objects += p->per_chunk;
+			}
+
+			p->chunk = c;
+			p->used = 0;
+		}
+
+		obj = first_object(p->chunk) + p->size * p->used++;
+	}
+
+	p->stats.gets++;
+	if (++p->stats.in_use > p->stats.peak)
+		p->stats.peak = p->stats.in_use;
+	return obj;
+}
+
+/**
+ * Give an object back to the pool it came from.
+ */
+void pool_put(struct pool *p, void *obj)
+{
+	*(void **)obj = p->free_list;
+	p->free_list = obj;
+	p->stats.puts++;
+	p->stats.in_use--;
+}
+
+/**
+ * Give every object back at once.
+ */
+void pool_reset(struct pool *p)
+{
+	p->chunk = NULL;
+	p->used = 0;
+	p->free_list = NULL;
+	p->stats.in_use = 0;
+}
+
+/**
+ * Free every chunk of a pool.
+ */
+void pool_free(struct pool *p)
+{
+	union chunk *c, *next;
+
+	for (c = p->chunks; c; c = next) {
+		next = c->next;
+		free(c);
+	}
+
+	pool_init(p, p->size, p->per_chunk);
+}
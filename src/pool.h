@@ -0,0 +1,81 @@
+/**
+ * tp2 - Object Pools
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/* What a pool has allocated, and handed out */
+struct pool_stats {
+	unsigned long chunks;  /* Chunks allocated with malloc() */
+	unsigned long objects; /* Objects those chunks hold */
+	unsigned long in_use;  /* Objects handed out right now */
+	unsigned long peak;    /* Most objects handed out at once */
+	unsigned long gets;    /* Calls to pool_get() that succeeded */
+	unsigned long puts;    /* Objects given back, one at a time */
+};
+
+/**
+ * A pool of objects of one size.
+ *
+ * Objects are carved out of chunks, which are only allocated
+ * when every object in the existing ones is in use, and only
+ * freed by pool_free(). Getting and putting back an object
+ * never calls malloc() or free() otherwise.
+ */
+struct pool {
+	size_t size;       /* Size of an object, rounded up for alignment */
+	size_t per_chunk;  /* Objects in each chunk */
+	void *chunks;      /* Chunks, oldest first */
+	void *chunk;       /* Chunk that objects are being carved from */
+	size_t used;       /* Objects carved from that chunk */
+	void *free_list;   /* Objects that were put back */
+	struct pool_stats stats;
+};
+
+/**
+ * Set up an empty pool. Nothing is allocated until the first
+ * object is asked for.
+ *
+ * \param[out] p         Pool.
+ * \param[in]  size      Size of each object.
+ * \param[in]  per_chunk Objects to allocate at a time.
+ */
+void pool_init(struct pool *p, size_t size, size_t per_chunk);
+
+/**
+ * Get an object from a pool. Its contents are undefined.
+ *
+ * \param[in] p Pool.
+ * \return The object, or NULL if a new chunk couldn't be allocated.
+ */
+void *pool_get(struct pool *p);
+
+/**
+ * Give an object back to the pool it came from.
+ *
+ * \param[in] p   Pool.
+ * \param[in] obj Object.
+ */
+void pool_put(struct pool *p, void *obj);
+
+/**
+ * Give every object back at once, keeping the chunks for reuse.
+ *
+ * \param[in] p Pool.
+ */
+void pool_reset(struct pool *p);
+
+/**
+ * Free every chunk of a pool, leaving it empty.
+ *
+ * \param[in] p Pool.
+ */
+void pool_free(struct pool *p);
+
+#endif /* POOL_H */
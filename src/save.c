@@ -0,0 +1,328 @@
+/**
+ * tp2 - Saved Game Routines
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PDCURSES
+#include <unistd.h>
+#endif
+
+#include "game.h"
+#include "save.h"
+
+/**
+ * Layout of the file header:
+ *
+ *   0: "tp2"
+ *   3: Format version
+ *   4: Number of games (32-bit, big endian)
+ */
+#define HEADER_SIZE 8
+
+/**
+ * Layout of each saved game, following the header:
+ *
+ *   0: Packed board (see game_pack_board())
+ *   8: Score (SCORE_SIZE bytes, NUL-padded)
+ *  20: Game state
+ *  21: Game type
+ *  22: Last move
+ *  23: Tile generator state (32-bit, big endian)
+ *  27: Reserved (zero)
+ */
+#define RECORD_SIZE 32
+
+#if PACKED_BOARD_SIZE > 8 || SCORE_SIZE > 12
+#error "The save file layout needs to be updated."
+#endif
+
+/**
+ * Layout of a weights file:
+ *
+ *   0: "tp2w"
+ *   4: Format version
+ *   5: Size of a float
+ *   6: Reserved (zero)
+ *   8: Number of weights (32-bit, big endian)
+ *  12: 1.5, as a float (to catch a different byte order)
+ *  16: The weights, as floats in the machine's byte order
+ */
+#define WEIGHTS_HEADER_SIZE 16
+
+/* Error messages */
+static const char *error_messages[7] = {
+	"unable to write the save file",
+	"unable to read the save file",
+	"not a tp2 save file, or an unsupported version",
+	"no such game in the save file",
+	"unable to write the weights file",
+	"unable to read the weights file",
+	"not a tp2 weights file, or one for another network or machine"
+};
+
+/**
+ * Store a 32-bit number in big endian byte order.
+ *
+ * \param[out] p Buffer to write to.
+ * \param[in]  n Number to store.
+ */
+static void put32(unsigned char *p, unsigned long n)
+{
+	p[0] = (unsigned char)((n >> 24) & 0xff);
+	p[1] = (unsigned char)((n >> 16) & 0xff);
+	p[2] = (unsigned char)((n >> 8) & 0xff);
+	p[3] = (unsigned char)(n & 0xff);
+}
+
+/**
+ * Fetch a 32-bit number stored in big endian byte order.
+ *
+ * \param[in] p Buffer to read from.
+ * \return The number.
+ */
+static unsigned long get32(const unsigned char *p)
+{
+	return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) |
+	       ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+
+/**
+ * Get the name of the file that a save is written to, before
+ * it replaces the old one.
+ *
+ * \param[in] file Path to the save file.
+ * \return The name (to be freed by the caller), or NULL.
+ */
+static char *temp_name(const char *file)
+{
+	size_t len = strlen(file);
+	char *tmp;
+
+	if (!(tmp = malloc(len + 5)))
+		return NULL;
+	memcpy(tmp, file, len + 1);
+
+#ifdef PDCURSES
+	/* DOS only allows a 3 character extension. */
+	if (len) tmp[len - 1] = '~';
+#else
+	strcpy(tmp + len, ".tmp");
+#endif
+	return tmp;
+}
+
+/**
+ * Save a number of games to a file.
+ *
+ * The games are written to a temporary file first, which then
+ * replaces the old one, so being killed part of the way through
+ * a save never costs the previous one.
+ */
+const char *save_games(const char *file, const struct game *games,
+                       int count)
+{
+	unsigned char buf[RECORD_SIZE];
+	const char *err = NULL;
+	char *tmp;
+	FILE *fp;
+	int i;
+
+	if (!(tmp = temp_name(file)))
+		return error_messages[0];
+
+	if (!(fp = fopen(tmp, "wb"))) {
+		free(tmp);
+		return error_messages[0];
+	}
+
+	memcpy(buf, "tp2", 3);
+	buf[3] = SAVE_VERSION;
+	put32(buf + 4, (unsigned long)count);
+	if (fwrite(buf, HEADER_SIZE, 1, fp) != 1) {
+		err = error_messages[0];
+		goto ret;
+	}
+
+	for (i = 0; i < count; i++) {
+		memset(buf, 0, sizeof(buf));
+		game_pack_board(&games[i], buf);
+		memcpy(buf + 8, games[i].score, SCORE_SIZE);
+		buf[20] = games[i].game_state;
+		buf[21] = games[i].game_type;
+		buf[22] = games[i].last_move;
+		put32(buf + 23, games[i].rng);
+
+		if (fwrite(buf, RECORD_SIZE, 1, fp) != 1) {
+			err = error_messages[0];
+			goto ret;
+		}
+	}
+
+ret:
+#ifndef PDCURSES
+	/* Make sure the new save is on disk before it replaces the old. */
+	if (!err && (fflush(fp) || fsync(fileno(fp))))
+		err = error_messages[0];
+#endif
+	if (fclose(fp) && !err)
+		err = error_messages[0];
+
+#ifdef PDCURSES
+	/* DOS won't rename over an existing file. */
+	if (!err) remove(file);
+#endif
+	if (!err && rename(tmp, file))
+		err = error_messages[0];
+	if (err) remove(tmp);
+
+	free(tmp);
+	return err;
+}
+
+/**
+ * Load one game from a file written by save_games().
+ */
+const char *load_game(const char *file, int index, struct game *g)
+{
+	unsigned char buf[RECORD_SIZE];
+	const char *err = NULL;
+	FILE *fp;
+
+	if (!(fp = fopen(file, "rb")))
+		return error_messages[1];
+
+	if (fread(buf, HEADER_SIZE, 1, fp) != 1 ||
+	    memcmp(buf, "tp2", 3) || buf[3] != SAVE_VERSION) {
+		err = error_messages[2];
+		goto ret;
+	}
+
+	if (index < 0 || (unsigned long)index >= get32(buf + 4)) {
+		err = error_messages[3];
+		goto ret;
+	}
+
+	if (fseek(fp, HEADER_SIZE + (long)index * RECORD_SIZE, SEEK_SET) ||
+	    fread(buf, RECORD_SIZE, 1, fp) != 1) {
+		err = error_messages[1];
+		goto ret;
+	}
+
+	if (buf[20] > GAME_OVER || buf[21] < 1 || buf[21] > 15 ||
+	    buf[22] > MOVE_NONE) {
+		err = error_messages[2];
+		goto ret;
+	}
+
+	game_unpack_board(g, buf);
+	memcpy(g->score, buf + 8, SCORE_SIZE);
+	g->score[SCORE_SIZE] = 0;
+	g->game_state = buf[20];
+	g->game_type = buf[21];
+	g->last_move = buf[22];
+	g->rng = get32(buf + 23);
+
+ret:
+	fclose(fp);
+	return err;
+}
+
+/**
+ * Save the weights of a network to a file.
+ *
+ * Like save_games(), this writes a temporary file first.
+ */
+const char *save_weights(const char *file, const float *w,
+                         unsigned long count)
+{
+	unsigned char buf[WEIGHTS_HEADER_SIZE];
+	const char *err = NULL;
+	float check = 1.5f;
+	char *tmp;
+	FILE *fp;
+
+	if (!(tmp = temp_name(file)))
+		return error_messages[4];
+
+	if (!(fp = fopen(tmp, "wb"))) {
+		free(tmp);
+		return error_messages[4];
+	}
+
+	memset(buf, 0, sizeof(buf));
+	memcpy(buf, "tp2w", 4);
+	buf[4] = WEIGHTS_VERSION;
+	buf[5] = (unsigned char)sizeof(float);
+	put32(buf + 8, count);
+	memcpy(buf + 12, &check, sizeof(float));
+	if (fwrite(buf, WEIGHTS_HEADER_SIZE, 1, fp) != 1 ||
+	    fwrite(w, sizeof(float), count, fp) != count)
+		err = error_messages[4];
+
+#ifndef PDCURSES
+	if (!err && (fflush(fp) || fsync(fileno(fp))))
+		err = error_messages[4];
+#endif
+	if (fclose(fp) && !err)
+		err = error_messages[4];
+
+#ifdef PDCURSES
+	if (!err) remove(file);
+#endif
+	if (!err && rename(tmp, file))
+		err = error_messages[4];
+	if (err) remove(tmp);
+
+	free(tmp);
+	return err;
+}
+
+/**
+ * Load the weights of a network saved by save_weights().
+ */
+const char *load_weights(const char *file, float *w, unsigned long count)
+{
+	unsigned char buf[WEIGHTS_HEADER_SIZE];
+	const char *err = NULL;
+	float check;
+	FILE *fp;
+
+	if (!(fp = fopen(file, "rb")))
+		return error_messages[5];
+
+	if (fread(buf, WEIGHTS_HEADER_SIZE, 1, fp) != 1) {
+		err = error_messages[5];
+		goto ret;
+	}
+
+	memcpy(&check, buf + 12, sizeof(float));
+	if (memcmp(buf, "tp2w", 4) || buf[4] != WEIGHTS_VERSION ||
+	    buf[5] != sizeof(float) || get32(buf + 8) != count ||
+	    check != 1.5f) {
+		err = error_messages[6];
+		goto ret;
+	}
+
+	if (fread(w, sizeof(float), count, fp) != count)
+		err = error_messages[5];
+
+ret:
+	fclose(fp);
+	return err;
+}
+
+/**
+ * Check whether an error from load_game() only means that
+ * the file holds fewer games than were asked for.
+ */
+int load_game_missing(const char *err)
+{
+	return err == error_messages[3];
+}
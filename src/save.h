@@ -0,0 +1,80 @@
+/**
+ * tp2 - Saved Game Routines
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef SAVE_H
+#define SAVE_H
+
+/* Version of the save file format. */
+#define SAVE_VERSION 1
+
+/* Version of the weights file format. */
+#define WEIGHTS_VERSION 1
+
+struct game;
+
+/**
+ * Save a number of games to a file.
+ *
+ * Every game takes the same number of bytes in the file,
+ * so any one of them can be loaded without reading the rest.
+ *
+ * \param[in] file  Path to the file.
+ * \param[in] games Array of games to save.
+ * \param[in] count Number of games in the array.
+ * \return NULL on success, error message on error.
+ */
+const char *save_games(const char *file, const struct game *games,
+                       int count);
+
+/**
+ * Load one game from a file written by save_games().
+ *
+ * \param[in]  file  Path to the file.
+ * \param[in]  index Index of the game in the file.
+ * \param[out] g     Game state.
+ * \return NULL on success, error message on error.
+ */
+const char *load_game(const char *file, int index, struct game *g);
+
+/**
+ * Check whether an error from load_game() only means that
+ * the file holds fewer games than were asked for.
+ *
+ * \param[in] err Error message returned by load_game().
+ * \return 1 if the game isn't in the file, 0 otherwise.
+ */
+int load_game_missing(const char *err);
+
+/**
+ * Save the weights of a network (e.g. an n-tuple network, see
+ * ntuple.h) to a file.
+ *
+ * The weights are stored as they are in memory, after a short
+ * header, so loading them is a single read.
+ *
+ * \param[in] file  Path to the file.
+ * \param[in] w     Weights.
+ * \param[in] count Number of weights.
+ * \return NULL on success, error message on error.
+ */
+const char *save_weights(const char *file, const float *w,
+                         unsigned long count);
+
+/**
+ * Load the weights of a network saved by save_weights().
+ *
+ * The file must hold exactly count weights, saved on a machine
+ * with the same float format.
+ *
+ * \param[in]  file  Path to the file.
+ * \param[out] w     Weights.
+ * \param[in]  count Number of weights.
+ * \return NULL on success, error message on error.
+ */
+const char *load_weights(const char *file, float *w, unsigned long count);
+
+#endif /* SAVE_H */
@@ -0,0 +1,519 @@
+/**
+ * tp2 - Game Server
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <curses.h>
+
+#include "game.h"
+#include "pool.h"
+#include "server.h"
+
+#if PACKED_BOARD_SIZE > 8 || SCORE_SIZE > 12
+#error "The reply layout needs to be updated."
+#endif
+
+/* Signal flag (see main.c) */
+extern volatile sig_atomic_t got_signal;
+
+/* Fds left over for everything but the connections */
+#define RESERVED_FDS 16
+
+/* Most connections served at once, whatever the fd limit */
+#define MAX_SESSIONS 65536UL
+
+/* Requests read from a connection per wakeup, at most */
+#define BATCH 32
+
+/* Sessions allocated at a time */
+#define SESSIONS_PER_CHUNK 64
+
+/* A connection, and its game */
+struct session {
+	int fd;
+	int playing;
+	size_t in_len, out_len, out_off;
+	unsigned char in[BATCH * SERVER_REQUEST_SIZE];
+	unsigned char out[BATCH * SERVER_REPLY_SIZE];
+	struct game game;
+};
+
+/**
+ * Sessions, and the fds poll() watches. Slot 0 is the listening
+ * socket, and every other slot holds a session's connection.
+ */
+static struct pool session_pool;
+static struct pollfd *fds = NULL;
+static struct session **sessions = NULL;
+static unsigned long n_fds = 0, max_sessions = 0;
+
+/* Seed for the next new game */
+static unsigned long seed;
+
+/* Connection to the server (see client_connect()) */
+static int client_fd = -1;
+
+/* Error messages */
+static const char *error_messages[6] = {
+	"the socket path is too long",
+	"unable to listen on the socket",
+	"unable to connect to the server",
+	"lost the connection to the server",
+	"the server refused the request",
+	"unable to allocate the sessions"
+};
+
+static void sighandler(int sig)
+{
+	(void)sig;
+	got_signal = 1;
+}
+
+/**
+ * Fill in the address of a socket.
+ *
+ * \param[out] addr Address.
+ * \param[in]  path Path of the socket.
+ * \return 0 on success, -1 if the path is too long.
+ */
+static int socket_address(struct sockaddr_un *addr, const char *path)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr->sun_path))
+		return -1;
+	strcpy(addr->sun_path, path);
+	return 0;
+}
+
+/**
+ * Store a 32-bit number in big endian byte order.
+ *
+ * \param[out] p Buffer to write to.
+ * \param[in]  v Number.
+ */
+static void put32(unsigned char *p, unsigned long v)
+{
+	p[0] = (unsigned char)(v >> 24);
+	p[1] = (unsigned char)(v >> 16);
+	p[2] = (unsigned char)(v >> 8);
+	p[3] = (unsigned char)v;
+}
+
+/**
+ * Answer one request.
+ *
+ * \param[in]  s     Session.
+ * \param[in]  req   Request.
+ * \param[out] reply Reply (SERVER_REPLY_SIZE bytes.)
+ */
+static void answer(struct session *s, const unsigned char *req,
+                   unsigned char *reply)
+{
+	struct game *g = &s->game;
+	int arg = req[1], moved = 0;
+
+	memset(reply, 0, SERVER_REPLY_SIZE);
+	reply[0] = req[0];
+
+	switch (req[0]) {
+	case SERVER_NEW:
+		if (!arg) arg = 11;
+		if (arg < 10 || arg > 15) {
+			reply[1] = SERVER_BAD_REQUEST;
+			return;
+		}
+
+		seed = (seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+		init_game_state(g, arg, seed);
+		s->playing = 1;
+		break;
+	case SERVER_MOVE:
+		if (arg > MOVE_RIGHT) {
+			reply[1] = SERVER_BAD_REQUEST;
+			return;
+		}
+
+		/* A finished game stays as it is. */
+		if (s->playing && !g->game_state)
+			moved = game_move(g, arg);
+		break;
+	case SERVER_STATE:
+	case SERVER_LEGAL:
+		break;
+	case SERVER_STATS:
+		put32(reply + 2, session_pool.stats.chunks);
+		put32(reply + 6, session_pool.stats.objects);
+		put32(reply + 10, session_pool.stats.in_use);
+		put32(reply + 14, session_pool.stats.peak);
+		put32(reply + 18, session_pool.stats.gets);
+		put32(reply + 22, session_pool.stats.puts);
+		return;
+	default:
+		reply[1] = SERVER_BAD_REQUEST;
+		return;
+	}
+
+	if (!s->playing) {
+		reply[1] = SERVER_NO_GAME;
+		return;
+	}
+
+	reply[2] = g->game_state;
+	reply[3] = g->game_type;
+	reply[4] = (unsigned char)moved;
+	reply[5] = (unsigned char)(g->game_state ? 0 : game_legal_moves(g));
+	game_pack_board(g, reply + 6);
+	memcpy(reply + 14, g->score, SCORE_SIZE);
+}
+
+/**
+ * Write as much of a session's pending replies as the socket
+ * will take.
+ *
+ * \param[in] s Session.
+ * \return 0 on success, -1 if the connection was lost.
+ */
+static int flush(struct session *s)
+{
+	ssize_t n;
+
+	while (s->out_off < s->out_len) {
+		n = write(s->fd, s->out + s->out_off, s->out_len - s->out_off);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		}
+		s->out_off += (size_t)n;
+	}
+
+	s->out_len = s->out_off = 0;
+	return 0;
+}
+
+/**
+ * Read whatever requests a session has sent, answer them
+ * all, and send the replies back together.
+ *
+ * \param[in] s Session.
+ * \return 0 on success, -1 if the connection was closed.
+ */
+static int serve(struct session *s)
+{
+	size_t i;
+	ssize_t n;
+
+	n = read(s->fd, s->in + s->in_len, sizeof(s->in) - s->in_len);
+	if (n < 0) return errno == EINTR || errno == EAGAIN ||
+	                  errno == EWOULDBLOCK ? 0 : -1;
+	if (!n) return -1;
+	s->in_len += (size_t)n;
+
+	for (i = 0; i + SERVER_REQUEST_SIZE <= s->in_len;
+	     i += SERVER_REQUEST_SIZE) {
+		answer(s, s->in + i, s->out + s->out_len);
+		s->out_len += SERVER_REPLY_SIZE;
+	}
+
+	/* Keep the start of a request that's still on its way. */
+	memmove(s->in, s->in + i, s->in_len - i);
+	s->in_len -= i;
+	return flush(s);
+}
+
+/**
+ * Work out how many connections can be served at once, raising
+ * the limit on open fds as far as we're allowed to.
+ *
+ * \return The number of connections.
+ */
+static unsigned long session_limit(void)
+{
+	struct rlimit rl;
+	rlim_t want = (rlim_t)(MAX_SESSIONS + RESERVED_FDS);
+
+	if (getrlimit(RLIMIT_NOFILE, &rl))
+		return 1024 - RESERVED_FDS;
+
+	if (rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < want &&
+	    rl.rlim_max != rl.rlim_cur) {
+		rl.rlim_cur = rl.rlim_max == RLIM_INFINITY ||
+		              rl.rlim_max > want ? want : rl.rlim_max;
+		if (setrlimit(RLIMIT_NOFILE, &rl))
+			getrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	if (rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur >= want)
+		return MAX_SESSIONS;
+	if (rl.rlim_cur <= 2 * RESERVED_FDS)
+		return RESERVED_FDS;
+	return (unsigned long)rl.rlim_cur - RESERVED_FDS;
+}
+
+/**
+ * Accept as many waiting connections as there is room for.
+ *
+ * \param[in] fd Listening socket.
+ * \return 1 if we've run out of fds, 0 otherwise.
+ */
+static int accept_sessions(int fd)
+{
+	struct session *s;
+	int c;
+
+	while (n_fds <= max_sessions) {
+		if ((c = accept(fd, NULL, NULL)) < 0) {
+			if (errno == EINTR) continue;
+			return errno == EMFILE || errno == ENFILE;
+		}
+
+		if (fcntl(c, F_SETFL, fcntl(c, F_GETFL) | O_NONBLOCK) ||
+		    !(s = pool_get(&session_pool))) {
+			close(c);
+			continue;
+		}
+
+		memset(s, 0, sizeof(*s));
+		s->fd = c;
+		sessions[n_fds] = s;
+		fds[n_fds].fd = c;
+		fds[n_fds].events = POLLIN;
+		fds[n_fds++].revents = 0;
+	}
+
+	return 0;
+}
+
+/**
+ * Close a session, and return it to the pool.
+ *
+ * The last slot moves into the one that was freed, so the
+ * slots stay packed.
+ *
+ * \param[in] i Slot of the session.
+ */
+static void close_session(unsigned long i)
+{
+	close(sessions[i]->fd);
+	pool_put(&session_pool, sessions[i]);
+
+	n_fds--;
+	fds[i] = fds[n_fds];
+	sessions[i] = sessions[n_fds];
+}
+
+/**
+ * Listen on a Unix domain socket, and serve one game to
+ * each connection, until a signal is received.
+ *
+ * Each connection's requests are answered in batches: every
+ * time poll() says a connection has something to read, all
+ * of the requests it holds are answered, and the replies go
+ * back in a single write. While a connection isn't taking its
+ * replies, no more of its requests are read.
+ *
+ * When accept() runs out of fds, the listening socket isn't
+ * watched again until a connection closes, or a second has
+ * passed, rather than waking up over and over for connections
+ * that can't be accepted.
+ */
+const char *server_run(const char *path)
+{
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	const char *err = NULL;
+	struct session *s;
+	unsigned long i;
+	time_t paused = 0;
+	int fd, n, closed;
+
+	if (socket_address(&addr, path))
+		return error_messages[0];
+
+	max_sessions = session_limit();
+	pool_init(&session_pool, sizeof(struct session), SESSIONS_PER_CHUNK);
+	fds = malloc((max_sessions + 1) * sizeof(*fds));
+	sessions = malloc((max_sessions + 1) * sizeof(*sessions));
+	if (!fds || !sessions) {
+		err = error_messages[5];
+		goto ret;
+	}
+	seed = (unsigned long)time(NULL) & 0xffffffffUL;
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		err = error_messages[1];
+		goto ret;
+	}
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(fd, SOMAXCONN) ||
+	    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK)) {
+		close(fd);
+		err = error_messages[1];
+		goto ret;
+	}
+
+	fds[0].fd = fd;
+	sessions[0] = NULL;
+	n_fds = 1;
+
+	/* Stop cleanly on a signal, and let dropped clients go. */
+	memset(&sa, 0, sizeof(struct sigaction));
+	sigemptyset(&sa.sa_mask);
+	sa.sa_handler = sighandler;
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, NULL);
+
+	while (!got_signal) {
+		fds[0].events = (short)(paused || n_fds > max_sessions ?
+		                        0 : POLLIN);
+		for (i = 1; i < n_fds; i++)
+			fds[i].events = sessions[i]->out_len ? POLLOUT : POLLIN;
+
+		if ((n = poll(fds, (nfds_t)n_fds, paused ? 1000 : -1)) < 0) {
+			if (errno == EINTR) continue;
+			err = error_messages[1];
+			break;
+		}
+
+		/**
+		 * Go backwards, so that the session moved into a closed
+		 * one's slot has already been seen to.
+		 */
+		for (i = n_fds - 1, closed = 0; n && i > 0; i--) {
+			if (!fds[i].revents) continue;
+			s = sessions[i];
+			if (s->out_len ? flush(s) : serve(s)) {
+				close_session(i);
+				closed = 1;
+			}
+		}
+
+		if (paused && (closed || time(NULL) > paused))
+			paused = 0;
+		if ((fds[0].revents & POLLIN) && accept_sessions(fd))
+			paused = time(NULL);
+	}
+
+	while (n_fds > 1) close_session(n_fds - 1);
+	close(fd);
+	unlink(path);
+
+ret:
+	free(fds);
+	free(sessions);
+	fds = NULL;
+	sessions = NULL;
+	n_fds = 0;
+	pool_free(&session_pool);
+	return err;
+}
+
+/**
+ * Connect to a server started with server_run().
+ */
+const char *client_connect(const char *path)
+{
+	struct sockaddr_un addr;
+
+	if (socket_address(&addr, path))
+		return error_messages[0];
+
+	if ((client_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		return error_messages[2];
+
+	if (connect(client_fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		close(client_fd);
+		client_fd = -1;
+		return error_messages[2];
+	}
+
+	return NULL;
+}
+
+/**
+ * Send a request to the server, and update a copy of the
+ * game from the reply.
+ */
+const char *client_request(struct game *g, int request, int arg)
+{
+	unsigned char buf[SERVER_REPLY_SIZE];
+	size_t got = 0;
+	ssize_t n;
+
+	buf[0] = (unsigned char)request;
+	buf[1] = (unsigned char)arg;
+	while ((n = write(client_fd, buf, SERVER_REQUEST_SIZE)) < 0 &&
+	       errno == EINTR);
+	if (n != SERVER_REQUEST_SIZE)
+		return error_messages[3];
+
+	while (got < sizeof(buf)) {
+		n = read(client_fd, buf + got, sizeof(buf) - got);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return error_messages[3];
+		got += (size_t)n;
+	}
+
+	if (buf[0] != request || buf[1] != SERVER_OK)
+		return error_messages[4];
+
+	g->game_state = buf[2];
+	g->game_type = buf[3];
+	game_unpack_board(g, buf + 6);
+	memcpy(g->score, buf + 14, SCORE_SIZE);
+	g->score[SCORE_SIZE] = '\0';
+	return NULL;
+}
+
+/**
+ * Handle input from the user, by sending the moves to
+ * the server.
+ */
+const char *client_handle_key(struct game *g, int key)
+{
+	if (g->game_state)
+		return key == 'r' ?
+		       client_request(g, SERVER_NEW, g->game_type) : NULL;
+
+	switch (key) {
+	case KEY_UP:
+		return client_request(g, SERVER_MOVE, MOVE_UP);
+	case KEY_DOWN:
+		return client_request(g, SERVER_MOVE, MOVE_DOWN);
+	case KEY_LEFT:
+		return client_request(g, SERVER_MOVE, MOVE_LEFT);
+	case KEY_RIGHT:
+		return client_request(g, SERVER_MOVE, MOVE_RIGHT);
+	}
+
+	return NULL;
+}
+
+/**
+ * Disconnect from the server.
+ */
+void client_disconnect(void)
+{
+	if (client_fd >= 0) close(client_fd);
+	client_fd = -1;
+}
@@ -0,0 +1,92 @@
+/**
+ * tp2 - Game Server
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef SERVER_H
+#define SERVER_H
+
+struct game;
+
+/**
+ * Requests are two bytes: one of these, and its argument
+ * (zero, unless stated otherwise.)
+ */
+#define SERVER_NEW   1 /* Start a new game (argument: game type) */
+#define SERVER_MOVE  2 /* Make a move (argument: MOVE_*) */
+#define SERVER_STATE 3 /* Get the state of the game */
+#define SERVER_LEGAL 4 /* Get the legal moves */
+#define SERVER_STATS 5 /* Get the session pool's statistics */
+
+#define SERVER_REQUEST_SIZE 2
+
+/**
+ * Each request is answered, in order, with one reply:
+ *
+ *   0: Request
+ *   1: Status (SERVER_OK, etc.)
+ *   2: Game state
+ *   3: Game type
+ *   4: Whether the move moved anything
+ *   5: Legal moves (bit (1 << MOVE_*) for each)
+ *   6: Packed board (see game_pack_board())
+ *  14: Score (SCORE_SIZE bytes, NUL-padded)
+ *
+ * except for SERVER_STATS, which answers with the fields of
+ * struct pool_stats (see pool.h) for the server's sessions,
+ * from offset 2, as six 32-bit big endian numbers.
+ */
+#define SERVER_REPLY_SIZE 26
+
+/* Reply status */
+#define SERVER_OK          0
+#define SERVER_BAD_REQUEST 1 /* Unknown request, or bad argument */
+#define SERVER_NO_GAME     2 /* No game has been started yet */
+
+/**
+ * Listen on a Unix domain socket, and serve one game to
+ * each connection, until a signal is received.
+ *
+ * \param[in] path Path of the socket.
+ * \return NULL on success, error message on error.
+ */
+const char *server_run(const char *path);
+
+/**
+ * Connect to a server started with server_run().
+ *
+ * \param[in] path Path of the socket.
+ * \return NULL on success, error message on error.
+ */
+const char *client_connect(const char *path);
+
+/**
+ * Send a request to the server, and update a copy of the
+ * game from the reply.
+ *
+ * \param[out] g       Game state.
+ * \param[in]  request One of the SERVER_* requests.
+ * \param[in]  arg     Argument.
+ * \return NULL on success, error message on error.
+ */
+const char *client_request(struct game *g, int request, int arg);
+
+/**
+ * Handle input from the user, as game_handle_key() does,
+ * but by sending the moves to the server. 'r' starts a new
+ * game, once the game is over.
+ *
+ * \param[out] g   Game state.
+ * \param[in]  key Key pressed by the user.
+ * \return NULL on success, error message on error.
+ */
+const char *client_handle_key(struct game *g, int key);
+
+/**
+ * Disconnect from the server.
+ */
+void client_disconnect(void);
+
+#endif /* SERVER_H */
@@ -0,0 +1,235 @@
+/**
+ * tp2 - Shared Memory Spectator Routines
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "game.h"
+#include "spectator.h"
+
+/**
+ * The published state, guarded by a sequence counter.
+ *
+ * The publisher makes the counter odd before it writes, and
+ * even again afterwards. Readers retry whenever the counter
+ * is odd, or changed while they were copying. Since there's
+ * a single writer, publishing never waits on anything, and
+ * is nothing more than a few stores to memory.
+ *
+ * Everything is volatile so that the compiler keeps the stores
+ * (and loads) in program order relative to the counter. The CPU
+ * may still reorder them, so there's a barrier around the copy
+ * where the compiler provides one, and a checksum to catch any
+ * torn frame that slips through where it doesn't.
+ */
+struct frame {
+	volatile unsigned long seq;
+	volatile unsigned short sum;
+	volatile unsigned char board[PACKED_BOARD_SIZE];
+	volatile char score[SCORE_SIZE + 1];
+	volatile unsigned char game_state;
+	volatile unsigned char game_type;
+	volatile unsigned char last_move;
+};
+
+/* Memory barrier, where the compiler has one */
+#if defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define BARRIER() __sync_synchronize()
+#else
+#define BARRIER()
+#endif
+
+/**
+ * Attempts spectator_read() makes at reading a frame before
+ * giving up until the next poll, in case the publisher died in
+ * the middle of an update.
+ */
+#define READ_ATTEMPTS 1000
+
+/* Shared memory segment */
+static int shmid = -1;
+static struct frame *frame;
+
+/* Non-zero if we created the segment */
+static int publisher = 0;
+
+/* Last sequence number read by spectator_read() */
+static unsigned long last_seq = 1;
+
+/* Error messages for spectator_publish() / spectator_watch() */
+static const char *error_messages[3] = {
+	"unable to create the shared memory segment",
+	"no game is being published with that key",
+	"a game is already being published with that key"
+};
+
+/**
+ * Attach to the segment.
+ *
+ * \param[in] key   IPC key identifying the segment.
+ * \param[in] flags shmget() flags.
+ * \return 0 on success, -1 on error.
+ */
+static int attach(long key, int flags)
+{
+	void *p;
+
+	shmid = shmget((key_t)key, sizeof(struct frame), flags);
+	if (shmid == -1) return -1;
+
+	p = shmat(shmid, NULL, publisher ? 0 : SHM_RDONLY);
+	if (p == (void *)-1) {
+		if (publisher) shmctl(shmid, IPC_RMID, NULL);
+		shmid = -1;
+		return -1;
+	}
+
+	frame = p;
+	return 0;
+}
+
+/**
+ * Create the shared memory segment that the game state
+ * will be published to.
+ */
+const char *spectator_publish(long key)
+{
+	/* There must only ever be one writer. */
+	publisher = 1;
+	if (attach(key, IPC_CREAT | IPC_EXCL | 0644)) {
+		publisher = 0;
+		return error_messages[errno == EEXIST ? 2 : 0];
+	}
+
+	frame->seq = 0;
+	return NULL;
+}
+
+/**
+ * Attach to a segment created by spectator_publish()
+ * in another process.
+ */
+const char *spectator_watch(long key)
+{
+	publisher = 0;
+	if (attach(key, 0))
+		return error_messages[1];
+	return NULL;
+}
+
+/**
+ * Compute the checksum of a frame's contents.
+ *
+ * \param[in] board Packed board.
+ * \param[in] score Score.
+ * \param[in] state Game state, game type and last move.
+ * \return The checksum.
+ */
+static unsigned short checksum(const unsigned char *board,
+                               const char *score,
+                               const unsigned char *state)
+{
+	unsigned int sum = 0;
+	int i;
+
+	for (i = 0; i < PACKED_BOARD_SIZE; i++)
+		sum = ((sum << 1 | sum >> 15) ^ board[i]) & 0xffff;
+	for (i = 0; i < SCORE_SIZE + 1; i++)
+		sum = ((sum << 1 | sum >> 15) ^ (unsigned char)score[i]) & 0xffff;
+	for (i = 0; i < 3; i++)
+		sum = ((sum << 1 | sum >> 15) ^ state[i]) & 0xffff;
+	return (unsigned short)sum;
+}
+
+/**
+ * Publish the current state of a game.
+ */
+void spectator_update(const struct game *g)
+{
+	unsigned char board[PACKED_BOARD_SIZE], state[3];
+	int i;
+
+	if (!frame || !publisher) return;
+	game_pack_board(g, board);
+	state[0] = g->game_state;
+	state[1] = g->game_type;
+	state[2] = g->last_move;
+
+	frame->seq++;
+	BARRIER();
+	for (i = 0; i < PACKED_BOARD_SIZE; i++)
+		frame->board[i] = board[i];
+	for (i = 0; i < SCORE_SIZE + 1; i++)
+		frame->score[i] = g->score[i];
+	frame->game_state = state[0];
+	frame->game_type = state[1];
+	frame->last_move = state[2];
+	frame->sum = checksum(board, g->score, state);
+	BARRIER();
+	frame->seq++;
+}
+
+/**
+ * Read the most recently published game state.
+ */
+int spectator_read(struct game *g)
+{
+	unsigned char board[PACKED_BOARD_SIZE], state[3];
+	char score[SCORE_SIZE + 1];
+	unsigned short sum;
+	unsigned long seq;
+	int i, attempts = READ_ATTEMPTS;
+
+	if (!frame) return 0;
+
+	for (;;) {
+		if (!attempts--) return 0;
+		if ((seq = frame->seq) & 1) continue;
+		if (seq == last_seq) return 0;
+		BARRIER();
+
+		for (i = 0; i < PACKED_BOARD_SIZE; i++)
+			board[i] = frame->board[i];
+		for (i = 0; i < SCORE_SIZE + 1; i++)
+			score[i] = frame->score[i];
+		state[0] = frame->game_state;
+		state[1] = frame->game_type;
+		state[2] = frame->last_move;
+		sum = frame->sum;
+		BARRIER();
+
+		if (seq == frame->seq && sum == checksum(board, score, state))
+			break;
+	}
+
+	game_unpack_board(g, board);
+	memcpy(g->score, score, sizeof(score));
+	g->game_state = state[0];
+	g->game_type = state[1];
+	g->last_move = state[2];
+	last_seq = seq;
+	return 1;
+}
+
+/**
+ * Detach from (and if publishing, remove) the segment.
+ */
+void spectator_uninit(void)
+{
+	if (!frame) return;
+
+	shmdt((void *)frame);
+	if (publisher) shmctl(shmid, IPC_RMID, NULL);
+	frame = NULL;
+	shmid = -1;
+}
@@ -0,0 +1,51 @@
+/**
+ * tp2 - Shared Memory Spectator Routines
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+struct game;
+
+/**
+ * Create the shared memory segment that the game state
+ * will be published to.
+ *
+ * \param[in] key IPC key identifying the segment.
+ * \return NULL on success, error message on error.
+ */
+const char *spectator_publish(long key);
+
+/**
+ * Attach to a segment created by spectator_publish()
+ * in another process.
+ *
+ * \param[in] key IPC key identifying the segment.
+ * \return NULL on success, error message on error.
+ */
+const char *spectator_watch(long key);
+
+/**
+ * Publish the current state of a game.
+ *
+ * \param[in] g Game state.
+ */
+void spectator_update(const struct game *g);
+
+/**
+ * Read the most recently published game state.
+ *
+ * \param[out] g Game state.
+ * \return 1 if the state changed since the last call, 0 otherwise.
+ */
+int spectator_read(struct game *g);
+
+/**
+ * Detach from (and if publishing, remove) the segment.
+ */
+void spectator_uninit(void);
+
+#endif /* SPECTATOR_H */
@@ -0,0 +1,164 @@
+/**
+ * tp2 - Game Statistics
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "game.h"
+#include "stats.h"
+
+/**
+ * Find the sketch bucket for a value.
+ *
+ * \param[in] v Value.
+ * \return Bucket index.
+ */
+static int bucket(unsigned long v)
+{
+	int e = 3;
+
+	if (v < 8) return (int)v;
+	while (e < 31 && (v >> (e + 1))) e++;
+	return 8 * (e - 2) + (int)((v >> (e - 3)) & 7);
+}
+
+/**
+ * Find the smallest value that falls into a bucket.
+ *
+ * \param[in] b Bucket index.
+ * \return The value.
+ */
+static unsigned long bucket_value(int b)
+{
+	if (b < 8) return (unsigned long)b;
+	return (8UL + (unsigned long)(b & 7)) << (b / 8 - 1);
+}
+
+/**
+ * Count a move.
+ */
+void stats_add_move(struct stats *s, const struct game *g)
+{
+	s->moves++;
+	s->merges += g->merges;
+}
+
+/**
+ * Count a game that has ended.
+ */
+void stats_add_game(struct stats *s, const struct game *g,
+                    unsigned long score, unsigned long length)
+{
+	int i, max = 0;
+
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++)
+		if (g->board[i] > max) max = g->board[i];
+
+	s->games++;
+	s->played[g->game_type & 0x0f]++;
+	if (g->game_state == GAME_WON)
+		s->won[g->game_type & 0x0f]++;
+	s->max_tile[max & 0x0f]++;
+
+	s->score[bucket(score)]++;
+	s->length[bucket(length)]++;
+	if (score > s->max_score) s->max_score = score;
+	if (length > s->max_length) s->max_length = length;
+}
+
+/**
+ * Add one set of statistics to another.
+ */
+void stats_merge(struct stats *dst, const struct stats *src)
+{
+	int i;
+
+	dst->games += src->games;
+	dst->moves += src->moves;
+	dst->merges += src->merges;
+
+	for (i = 0; i < 16; i++) {
+		dst->played[i] += src->played[i];
+		dst->won[i] += src->won[i];
+		dst->max_tile[i] += src->max_tile[i];
+	}
+
+	for (i = 0; i < SKETCH_BUCKETS; i++) {
+		dst->score[i] += src->score[i];
+		dst->length[i] += src->length[i];
+	}
+
+	if (src->max_score > dst->max_score)
+		dst->max_score = src->max_score;
+	if (src->max_length > dst->max_length)
+		dst->max_length = src->max_length;
+}
+
+/**
+ * Estimate a quantile from a sketch.
+ */
+unsigned long stats_quantile(const unsigned long *sketch, int permille)
+{
+	unsigned long n = 0, rank, seen = 0;
+	int i;
+
+	for (i = 0; i < SKETCH_BUCKETS; i++)
+		n += sketch[i];
+	if (!n) return 0;
+
+	rank = n / 1000 * (unsigned long)permille +
+	       n % 1000 * (unsigned long)permille / 1000;
+	for (i = 0; i < SKETCH_BUCKETS - 1; i++) {
+		seen += sketch[i];
+		if (seen > rank) break;
+	}
+
+	return bucket_value(i);
+}
+
+/**
+ * Write a snapshot of the statistics, on one line.
+ */
+int stats_write(const struct stats *s, FILE *fp, unsigned long elapsed)
+{
+	unsigned long mpm = 0;
+	const char *sep;
+	int i;
+
+	/* Merges per move, in thousandths */
+	if (s->moves)
+		mpm = s->merges / s->moves * 1000 +
+		      s->merges % s->moves * 1000 / s->moves;
+
+	fprintf(fp, "elapsed=%lu games=%lu moves=%lu merges/move=%lu.%03lu",
+	        elapsed, s->games, s->moves, mpm / 1000, mpm % 1000);
+	fprintf(fp, " score=%lu/%lu/%lu/%lu",
+	        stats_quantile(s->score, 500), stats_quantile(s->score, 900),
+	        stats_quantile(s->score, 990), s->max_score);
+	fprintf(fp, " length=%lu/%lu/%lu/%lu",
+	        stats_quantile(s->length, 500),
+	        stats_quantile(s->length, 900),
+	        stats_quantile(s->length, 990), s->max_length);
+
+	fputs(" max_tile=", fp);
+	for (i = 0, sep = ""; i < 16; i++) {
+		if (!s->max_tile[i]) continue;
+		fprintf(fp, "%s%lu:%lu", sep, 1UL << i, s->max_tile[i]);
+		sep = ",";
+	}
+
+	fputs(" won=", fp);
+	for (i = 10, sep = ""; i < 16; i++) {
+		if (!s->played[i]) continue;
+		fprintf(fp, "%s%d:%lu/%lu", sep, i, s->won[i], s->played[i]);
+		sep = ",";
+	}
+
+	fputc('\n', fp);
+	return (fflush(fp) || ferror(fp)) ? -1 : 0;
+}
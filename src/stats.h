@@ -0,0 +1,96 @@
+/**
+ * tp2 - Game Statistics
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+/**
+ * Number of buckets in a sketch.
+ *
+ * Values below 8 get a bucket each. Above that, each power of 2
+ * is split into 8 buckets, so a quantile is never more than 12.5%
+ * below the true value, for anything that fits in 32 bits.
+ */
+#define SKETCH_BUCKETS 240
+
+struct game;
+
+/**
+ * Statistics for any number of games.
+ *
+ * Only counters are kept, so memory use doesn't grow with the
+ * number of games, and two sets of statistics (e.g. from separate
+ * workers) can be combined with stats_merge().
+ */
+struct stats {
+	unsigned long games;
+	unsigned long moves;
+	unsigned long merges;
+
+	/* Games played and won, by game type */
+	unsigned long played[16];
+	unsigned long won[16];
+
+	/* Games ending with each exponent as their largest tile */
+	unsigned long max_tile[16];
+
+	/* Sketches of the score, and length (in moves) of each game */
+	unsigned long score[SKETCH_BUCKETS];
+	unsigned long length[SKETCH_BUCKETS];
+	unsigned long max_score;
+	unsigned long max_length;
+};
+
+/**
+ * Count a move.
+ *
+ * \param[in] s Statistics.
+ * \param[in] g Game the move was made in.
+ */
+void stats_add_move(struct stats *s, const struct game *g);
+
+/**
+ * Count a game that has ended.
+ *
+ * \param[in] s      Statistics.
+ * \param[in] g      Game that ended.
+ * \param[in] score  Points scored in the game.
+ * \param[in] length Number of moves made in the game.
+ */
+void stats_add_game(struct stats *s, const struct game *g,
+                    unsigned long score, unsigned long length);
+
+/**
+ * Add one set of statistics to another.
+ *
+ * \param[in] dst Statistics to add to.
+ * \param[in] src Statistics to add.
+ */
+void stats_merge(struct stats *dst, const struct stats *src);
+
+/**
+ * Estimate a quantile from a sketch.
+ *
+ * \param[in] sketch  Sketch (stats.score or stats.length.)
+ * \param[in] permille Quantile, in thousandths (e.g. 500 for the median.)
+ * \return The smallest value in the bucket holding the quantile.
+ */
+unsigned long stats_quantile(const unsigned long *sketch, int permille);
+
+/**
+ * Write a snapshot of the statistics, on one line.
+ *
+ * \param[in] s       Statistics.
+ * \param[in] fp      File to write to.
+ * \param[in] elapsed Seconds since the statistics were started.
+ * \return 0 on success, -1 on error.
+ */
+int stats_write(const struct stats *s, FILE *fp, unsigned long elapsed);
+
+#endif /* STATS_H */
@@ -0,0 +1,153 @@
+/**
+ * tp2 - Endgame Tablebases
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "tablebase.h"
+
+/**
+ * Layout of a tablebase file:
+ *
+ *   0: "tp2b"
+ *   4: Format version
+ *   5: Board width
+ *   6: Board height
+ *   7: Game type
+ *   8: Number of positions (32-bit, big endian)
+ *  12: Reserved (zero)
+ *  16: For each position, the chance of winning from it, from 0 to
+ *      TABLEBASE_ONE, or 65535 if it isn't reachable (16-bit, big
+ *      endian.) The tiles of a position are the digits of its index
+ *      in base game_type, cell 0 being the lowest.
+ */
+#define HEADER_SIZE 16
+
+/* The tablebase, and what it's for */
+static unsigned char *table = NULL;
+static int table_type = 0;
+
+/* Error messages for tablebase_load() */
+static const char *error_messages[4] = {
+	"unable to read the tablebase",
+	"not a tp2 tablebase, or an unsupported version",
+	"the tablebase is for another size of board",
+	"unable to allocate the tablebase"
+};
+
+/**
+ * Load a tablebase written by tools/mktb.
+ */
+const char *tablebase_load(const char *file)
+{
+	unsigned char buf[HEADER_SIZE];
+	const char *err = NULL;
+	unsigned long n = 1;
+	FILE *fp;
+	int i;
+
+	tablebase_unload();
+	if (!(fp = fopen(file, "rb")))
+		return error_messages[0];
+
+	if (fread(buf, HEADER_SIZE, 1, fp) != 1) {
+		err = error_messages[0];
+		goto ret;
+	}
+
+	if (memcmp(buf, "tp2b", 4) || buf[4] != TABLEBASE_VERSION ||
+	    buf[7] < 2 || buf[7] > 15) {
+		err = error_messages[1];
+		goto ret;
+	}
+
+	if (buf[5] != BOARD_WIDTH || buf[6] != BOARD_HEIGHT) {
+		err = error_messages[2];
+		goto ret;
+	}
+
+	/* There's one entry for each combination of tiles. */
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		if (n > 0xffffffffUL / buf[7]) {
+			err = error_messages[1];
+			goto ret;
+		}
+		n *= buf[7];
+	}
+
+	if (n != (((unsigned long)buf[8] << 24) |
+	          ((unsigned long)buf[9] << 16) |
+	          ((unsigned long)buf[10] << 8) | (unsigned long)buf[11])) {
+		err = error_messages[1];
+		goto ret;
+	}
+
+	if (!(table = malloc(n * 2))) {
+		err = error_messages[3];
+		goto ret;
+	}
+
+	if (fread(table, 2, n, fp) != n) {
+		free(table);
+		table = NULL;
+		err = error_messages[0];
+		goto ret;
+	}
+
+	table_type = buf[7];
+
+ret:
+	fclose(fp);
+	return err;
+}
+
+/**
+ * Unload the tablebase.
+ */
+void tablebase_unload(void)
+{
+	free(table);
+	table = NULL;
+	table_type = 0;
+}
+
+/**
+ * Check whether the tablebase is for a game's type.
+ */
+int tablebase_covers(const struct game *g)
+{
+	return table && g->game_type == table_type;
+}
+
+/**
+ * Look up a position.
+ */
+long tablebase_probe(const struct game *g)
+{
+	unsigned long i = 0;
+	long v;
+	int c;
+
+	if (!tablebase_covers(g))
+		return -1;
+
+	/**
+	 * A board holding the winning tile is won, unless the tile
+	 * added with it left no move (see game_move().)
+	 */
+	for (c = BOARD_WIDTH * BOARD_HEIGHT - 1; c >= 0; c--) {
+		if (g->board[c] >= table_type)
+			return game_is_over(g) ? 0 : TABLEBASE_ONE;
+		i = i * (unsigned long)table_type + (unsigned long)g->board[c];
+	}
+
+	v = ((long)table[2 * i] << 8) | (long)table[2 * i + 1];
+	return v > TABLEBASE_ONE ? -1 : v;
+}
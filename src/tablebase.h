@@ -0,0 +1,59 @@
+/**
+ * tp2 - Endgame Tablebases
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+/* Version of the tablebase file format. */
+#define TABLEBASE_VERSION 1
+
+/* Value of a position that is sure to be won */
+#define TABLEBASE_ONE 65534L
+
+/**
+ * A tablebase holds the chance of winning, with the best play,
+ * from every position reachable in one game type on one size of
+ * board (see tools/mktb.c.) Positions are looked up directly by
+ * their tiles, each tile being a digit in base game_type.
+ *
+ * Only one tablebase is loaded at a time.
+ */
+
+struct game;
+
+/**
+ * Load a tablebase written by tools/mktb, replacing any other.
+ *
+ * \param[in] file Path to the file.
+ * \return NULL on success, error message on error.
+ */
+const char *tablebase_load(const char *file);
+
+/**
+ * Unload the tablebase, if any.
+ */
+void tablebase_unload(void);
+
+/**
+ * Check whether the tablebase is for a game's type.
+ *
+ * \param[in] g Game state.
+ * \return 1 if it is, 0 otherwise (or if none is loaded.)
+ */
+int tablebase_covers(const struct game *g);
+
+/**
+ * Look up a position (before the player's move.) A board holding
+ * the winning tile is sure to be won, unless it has no move left.
+ *
+ * \param[in] g Game state.
+ * \return The chance of winning, from 0 to TABLEBASE_ONE, or -1
+ *         if the position isn't in the tablebase.
+ */
+long tablebase_probe(const struct game *g);
+
+#endif /* TABLEBASE_H */
@@ -0,0 +1,48 @@
+/**
+ * tp2 - Move Tables
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef TABLES_H
+#define TABLES_H
+
+#include "game.h"
+
+/**
+ * The tables are generated by tools/mktables when tp2 is built,
+ * and compiled into read-only data, so they cost nothing to set
+ * up, and every running tp2 shares the same pages.
+ *
+ * Lines of more than 4 cells would need a megabyte or more of
+ * tables, so the engine's own routines are used for those.
+ */
+#if BOARD_WIDTH > 4 || BOARD_HEIGHT > 4
+#undef HAVE_ROW_TABLES
+#endif
+
+#ifdef HAVE_ROW_TABLES
+
+/* Number of packed lines of BOARD_WIDTH / BOARD_HEIGHT cells */
+#define ROW_ENTRIES    (1L << (BOARD_WIDTH << 2))
+#define COLUMN_ENTRIES (1L << (BOARD_HEIGHT << 2))
+
+/**
+ * Each packed line (see line_move()) moved towards its first
+ * cell, and the exponent of the tile merged by the move (or -1
+ * if there was no merge.)
+ */
+extern const unsigned short row_moves[ROW_ENTRIES];
+extern const signed char row_merges[ROW_ENTRIES];
+
+#if BOARD_WIDTH == BOARD_HEIGHT
+#define column_moves  row_moves
+#define column_merges row_merges
+#else
+extern const unsigned short column_moves[COLUMN_ENTRIES];
+extern const signed char column_merges[COLUMN_ENTRIES];
+#endif
+
+#endif /* HAVE_ROW_TABLES */
+#endif /* TABLES_H */
@@ -82,6 +82,7 @@ const char *term_init(void)
 	sa.sa_handler = sighandler;
 	sigaction(SIGTERM, &sa, NULL);
 	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGHUP, &sa, NULL);
 #ifdef SIGWINCH
 	sigaction(SIGWINCH, &sa, NULL);
 #endif
@@ -0,0 +1,328 @@
+/**
+ * tp2 - Policy Tournament
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "game.h"
+#include "policy.h"
+#include "ntuple.h"
+#include "save.h"
+#include "tournament.h"
+
+/* Number of policies in the line-up */
+#define POLICIES 6
+
+/**
+ * The line-up. The first policy is the baseline that the
+ * others are compared against. The last one only plays when
+ * it has been given the weights of an n-tuple network.
+ */
+static struct policy lineup[POLICIES] = {
+	{ "random",        POLICY_RANDOM,     0,  0, NULL },
+	{ "greedy",        POLICY_GREEDY,     0,  0, NULL },
+	{ "expectimax/2",  POLICY_EXPECTIMAX, 2,  0, NULL },
+	{ "expectimax/3",  POLICY_EXPECTIMAX, 3,  0, NULL },
+	{ "montecarlo/20", POLICY_MONTECARLO, 20, 0, NULL },
+	{ "ntuple",        POLICY_NTUPLE,     0,  0, NULL }
+};
+
+/* Number of policies playing */
+static int policies = POLICIES - 1;
+
+/* Outcome of one game for each policy */
+struct result {
+	unsigned long score[POLICIES];
+	unsigned long moves[POLICIES];
+	unsigned long clocks[POLICIES];
+	int won[POLICIES];
+};
+
+/* Totals for one policy */
+struct total {
+	double score, score2;
+	double diff, diff2;
+	double moves, clocks;
+	unsigned long won;
+};
+
+/**
+ * Totals for a number of games. Each worker sends one of these
+ * when it's done, so workers never wait on a full pipe while the
+ * results of another worker are being read.
+ */
+struct summary {
+	struct total policy[POLICIES];
+	unsigned long played;
+};
+
+/* Totals for all games */
+static struct summary totals;
+
+/* Error messages for tournament_run() */
+static const char *error_messages[3] = {
+	"unable to start a worker",
+	"a worker failed to finish its games",
+	"unable to allocate the weights"
+};
+
+/**
+ * Play one game with each policy.
+ *
+ * \param[in]  seed Seed for the game (and the policies.)
+ * \param[in]  type Game type.
+ * \param[out] r    Results.
+ */
+static void play(unsigned long seed, int type, struct result *r)
+{
+	struct policy p;
+	struct game g;
+	clock_t start;
+	int i;
+
+	memset(r, 0, sizeof(*r));
+	for (i = 0; i < policies; i++) {
+		/**
+		 * The policies use the same generator as the game, so
+		 * they need a seed of their own to play independently
+		 * of where the tiles appear.
+		 */
+		p = lineup[i];
+		p.rng = seed ^ 0x9e3779b9UL;
+		init_game_state(&g, type, seed);
+
+		start = clock();
+		while (!g.game_state) {
+			game_move(&g, policy_move(&p, &g));
+			r->score[i] += g.reward;
+			r->moves[i]++;
+		}
+
+		r->clocks[i] = (unsigned long)(clock() - start);
+		r->won[i] = g.game_state == GAME_WON;
+	}
+}
+
+/**
+ * Add a game's results to a summary.
+ *
+ * \param[in] s Summary.
+ * \param[in] r Results.
+ */
+static void add_result(struct summary *s, const struct result *r)
+{
+	struct total *t;
+	double d;
+	int i;
+
+	for (i = 0; i < policies; i++) {
+		t = &s->policy[i];
+		d = (double)r->score[i] - (double)r->score[0];
+		t->score += (double)r->score[i];
+		t->score2 += (double)r->score[i] * (double)r->score[i];
+		t->diff += d;
+		t->diff2 += d * d;
+		t->moves += (double)r->moves[i];
+		t->clocks += (double)r->clocks[i];
+		t->won += (unsigned long)r->won[i];
+	}
+
+	s->played++;
+}
+
+/**
+ * Add a worker's summary to the totals.
+ *
+ * The sums are of integers well below 2^53, so they're exact,
+ * and the totals don't depend on how the games were split up.
+ *
+ * \param[in] s Summary.
+ */
+static void add_summary(const struct summary *s)
+{
+	struct total *t;
+	int i;
+
+	for (i = 0; i < policies; i++) {
+		t = &totals.policy[i];
+		t->score += s->policy[i].score;
+		t->score2 += s->policy[i].score2;
+		t->diff += s->policy[i].diff;
+		t->diff2 += s->policy[i].diff2;
+		t->moves += s->policy[i].moves;
+		t->clocks += s->policy[i].clocks;
+		t->won += s->policy[i].won;
+	}
+
+	totals.played += s->played;
+}
+
+/**
+ * Find the square root of a number.
+ *
+ * \param[in] x Number.
+ * \return The square root.
+ */
+static double root(double x)
+{
+	double r = x;
+	int i;
+
+	if (x <= 0.0) return 0.0;
+	for (i = 0; i < 64; i++)
+		r = (r + x / r) / 2.0;
+	return r;
+}
+
+/**
+ * Find the half-width of the 95% confidence interval
+ * for the mean of a sample.
+ *
+ * \param[in] sum  Sum of the sample.
+ * \param[in] sum2 Sum of the squares of the sample.
+ * \return The half-width of the interval.
+ */
+static double ci95(double sum, double sum2)
+{
+	double n = (double)totals.played, var;
+
+	if (totals.played < 2) return 0.0;
+	var = (sum2 - sum * sum / n) / (n - 1.0);
+	return 1.96 * root(var / n);
+}
+
+/**
+ * Print the totals.
+ */
+static void print_results(void)
+{
+	const struct total *t = totals.policy;
+	double n = (double)totals.played;
+	int i;
+
+	printf("%-14s %14s %14s %6s %7s %9s\n", "policy", "mean score",
+	       "vs. baseline", "won", "moves", "us/move");
+
+	for (i = 0; i < policies; i++, t++) {
+		printf("%-14s %7.0f+/-%-5.0f %+7.0f+/-%-5.0f %6lu %7.0f %9.2f\n",
+		       lineup[i].name, t->score / n, ci95(t->score, t->score2),
+		       t->diff / n, ci95(t->diff, t->diff2), t->won,
+		       t->moves / n, t->moves ? t->clocks * 1e6 /
+		       CLOCKS_PER_SEC / t->moves : 0.0);
+	}
+}
+
+/**
+ * Read a whole summary from a worker.
+ *
+ * \param[in]  fd Pipe from the worker.
+ * \param[out] s  Summary.
+ * \return 1 if a summary was read, 0 otherwise.
+ */
+static int read_summary(int fd, struct summary *s)
+{
+	size_t got = 0;
+	ssize_t n;
+
+	while (got < sizeof(*s)) {
+		n = read(fd, (char *)s + got, sizeof(*s) - got);
+		if (n <= 0) return 0;
+		got += (size_t)n;
+	}
+
+	return 1;
+}
+
+/**
+ * Play each policy in the line-up on the same games, and
+ * print a comparison of the results.
+ */
+const char *tournament_run(int games, int workers, int type,
+                           const char *weights)
+{
+	int fds[TOURNAMENT_MAX_WORKERS];
+	const char *err = NULL;
+	struct summary s;
+	struct result r;
+	unsigned long seed;
+	float *w_ntuple = NULL;
+	int w, fd[2];
+	pid_t pid;
+
+	memset(&totals, 0, sizeof(totals));
+
+	/* The workers share the weights, since they only read them. */
+	policies = POLICIES - 1;
+	if (weights) {
+		if (!(w_ntuple = malloc(NTUPLE_WEIGHTS * sizeof(float))))
+			return error_messages[2];
+		if ((err = load_weights(weights, w_ntuple, NTUPLE_WEIGHTS))) {
+			free(w_ntuple);
+			return err;
+		}
+
+		lineup[POLICIES - 1].weights = w_ntuple;
+		policies = POLICIES;
+	}
+
+	if (workers < 1) workers = 1;
+	if (workers > games) workers = games;
+	if (workers > TOURNAMENT_MAX_WORKERS)
+		workers = TOURNAMENT_MAX_WORKERS;
+
+	/* Each worker plays every workers'th game. */
+	for (w = 0; w < workers; w++) {
+		fds[w] = -1;
+		if (pipe(fd)) {
+			err = error_messages[0];
+			break;
+		}
+
+		if (!(pid = fork())) {
+			close(fd[0]);
+			memset(&s, 0, sizeof(s));
+			for (seed = (unsigned long)w + 1;
+			     seed <= (unsigned long)games;
+			     seed += (unsigned long)workers) {
+				play(seed, type, &r);
+				add_result(&s, &r);
+			}
+
+			if (write(fd[1], &s, sizeof(s)) != sizeof(s))
+				_exit(EXIT_FAILURE);
+			_exit(EXIT_SUCCESS);
+		}
+
+		close(fd[1]);
+		if (pid == -1) {
+			close(fd[0]);
+			err = error_messages[0];
+			break;
+		}
+		fds[w] = fd[0];
+	}
+
+	/* Collect the results */
+	while (w--) {
+		if (read_summary(fds[w], &s))
+			add_summary(&s);
+		close(fds[w]);
+	}
+	while (wait(NULL) > 0);
+
+	if (!err && totals.played != (unsigned long)games)
+		err = error_messages[1];
+	if (!err) print_results();
+	free(w_ntuple);
+	return err;
+}
@@ -0,0 +1,32 @@
+/**
+ * tp2 - Policy Tournament
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ */
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+/* Maximum number of worker processes */
+#define TOURNAMENT_MAX_WORKERS 64
+
+/**
+ * Play each policy in the line-up on the same games, and
+ * print a comparison of the results.
+ *
+ * Game n (counting from 1) is seeded with n, so every policy
+ * faces the same sequence of random numbers, and the results
+ * are the same each time.
+ *
+ * \param[in] games   Number of games per policy.
+ * \param[in] workers Number of worker processes.
+ * \param[in] type    Game type (winning exponent of 2.)
+ * \param[in] weights File holding the weights of an n-tuple network
+ *                    to add to the line-up (see tp2-train), or NULL.
+ * \return NULL on success, error message on error.
+ */
+const char *tournament_run(int games, int workers, int type,
+                           const char *weights);
+
+#endif /* TOURNAMENT_H */
@@ -7,15 +7,27 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <curses.h>
 
 #include "game.h"
 #include "ui.h"
 
+#if BOARD_WIDTH != 4 || BOARD_HEIGHT != 4
+#error "The UI can only draw a 4x4 board."
+#endif
+
 /* Size of the game display area (in lines/cols) */
 #define WIDTH  29
 #define HEIGHT 20
 
+/* Size of a board on the dashboard (in lines/cols) */
+#define MINI_WIDTH  12
+#define MINI_HEIGHT 7
+
+/* Maximum number of boards on the dashboard */
+#define DASHBOARD_MAX 64
+
 /* Non-zero if the display has colors and the user wants colors */
 int colors = 1;
 
@@ -33,12 +45,30 @@ static int rows = 0;
  */
 static int screen_too_small = 0;
 
+/**
+ * Non-zero if the screen is too small for our display,
+ * but large enough to draw the board on the dashboard.
+ */
+static int compact = 0;
+
 /**
  * Non-zero if we already drew the grid that encapsulates
  * the cells.
  */
 static int rendered_grid = 0;
 
+/**
+ * What each board on the dashboard looked like when it was
+ * last drawn, so that boards which haven't changed can be
+ * skipped.
+ */
+static struct {
+	unsigned char board[PACKED_BOARD_SIZE];
+	char score[SCORE_SIZE + 1];
+	unsigned char game_state;
+	unsigned char drawn;
+} shown[DASHBOARD_MAX];
+
 static const char *instructions[4] = {
 	"Use the arrow keys to move the",
 	"tiles, Ctrl + C to exit       ",
@@ -66,6 +96,9 @@ static const char *numbers[16] = {
 	" 32768"
 };
 
+/* Exponents as displayed on the dashboard (one char per cell) */
+static const char exponents[] = ".123456789abcdef";
+
 /**
  * The default colors for rendering cells.
  *
@@ -216,15 +249,16 @@ static void define_colors(void)
  * If no colors are available, the blocks will be drawn in
  * reverse video mode.
  *
+ * \param[in] g    Game state.
  * \param[in] cell Cell number to draw
  */
-static void draw_cell(int cell)
+static void draw_cell(const struct game *g, int cell)
 {
 	int row, col, e;
 
 	row = cell & -4;
 	col = cell & 3;
-	e = board[cell] & 0x0f;
+	e = g->board[cell] & 0x0f;
 
 	if (colors) attron(COLOR_PAIR(cell_color_pairs[e]));
 	else if (e) attron(A_REVERSE);
@@ -285,22 +319,65 @@ static void draw_grid(void)
 	rendered_grid = 1;
 }
 
+/**
+ * Draw a board on the dashboard.
+ *
+ * Each board shows the score, the game type (or the outcome
+ * of the game) and one character per cell, giving the exponent
+ * of the cell's value in hex:
+ *
+ *  00000001204
+ *   2048
+ *  . 1 2 .
+ *  1 3 . .
+ *  4 5 2 1
+ *  7 8 a 1
+ *
+ * \param[in] g   Game state.
+ * \param[in] row Row to draw the board at.
+ * \param[in] col Column to draw the board at.
+ */
+static void draw_mini(const struct game *g, int row, int col)
+{
+	int i, e;
+
+	if (colors) attron(COLOR_PAIR(1));
+	mvaddstr(row, col, g->score);
+	if (g->game_state == GAME_WON)
+		mvaddstr(row + 1, col, " WON  ");
+	else if (g->game_state == GAME_OVER)
+		mvaddstr(row + 1, col, " OVER ");
+	else mvaddstr(row + 1, col, numbers[g->game_type]);
+	if (colors) attroff(COLOR_PAIR(1));
+
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		e = g->board[i] & 0x0f;
+		if (colors) attron(COLOR_PAIR(cell_color_pairs[e]));
+		else if (e) attron(A_REVERSE);
+		mvaddch(row + 2 + i / BOARD_WIDTH, col + (i % BOARD_WIDTH) * 2,
+		        (chtype)exponents[e]);
+		if (colors) attroff(COLOR_PAIR(cell_color_pairs[e]));
+		else if (e) attroff(A_REVERSE);
+	}
+}
+
 #ifdef DEBUG
 /**
  * Draw debug info on the left-hand side of the
  * screen, if the board is drawn after our
  * requisite 20 columns.
  */
-static void draw_debug(void)
+static void draw_debug(const struct game *g)
 {
+	const char *board = g->board;
 	int i;
 	if (col0 < 20) return;
 
 	mvaddstr(row0, 5, "DEBUG");
 	move(row0 + 2, 0);
-	printw("state       = %d", game_state);
+	printw("state       = %d", g->game_state);
 	move(row0 + 3, 0);
-	printw("board_state = 0x%04x", ~board_state & 0xffff);
+	printw("board_state = 0x%04x", ~g->board_state & 0xffff);
 
 	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i += BOARD_WIDTH) {
 		move(row0 + 5 + (i / BOARD_WIDTH), 0);
@@ -314,7 +391,7 @@ static void draw_debug(void)
 /**
  * Initialize the UI.
  */
-void ui_init(void)
+void ui_init(const struct game *g)
 {
 	/* Initialize curses */
 	initscr();
@@ -333,7 +410,7 @@ void ui_init(void)
 
 	/* Render the initial game state */
 	ui_window_size_changed();
-	ui_render_game_state();
+	if (g) ui_render_game_state(g);
 }
 
 /**
@@ -341,20 +418,23 @@ void ui_init(void)
  */
 void ui_window_size_changed(void)
 {
-	screen_too_small = 0;
+	screen_too_small = compact = 0;
+	memset(shown, 0, sizeof(shown));
 #ifndef PDCURSES
 	endwin();
 #endif
 	clear();
 	refresh();
 
-	if (COLS < WIDTH + 1 || LINES < HEIGHT + 1) {
+	if (COLS < MINI_WIDTH || LINES < MINI_HEIGHT) {
 		clear();
 		move(0, 0);
 		printw("The screen is too small to play this game.\n");
 		printw("Resize the window, or press Ctrl + C to exit.");
 		refresh();
 		screen_too_small = 1;
+	} else if (COLS < WIDTH + 1 || LINES < HEIGHT + 1) {
+		compact = 1;
 	} else if (col0 != (COLS - WIDTH) / 2 ||
 	           row0 != (LINES - HEIGHT) / 2) {
 		col0 = row0 = 1;
@@ -370,28 +450,34 @@ void ui_window_size_changed(void)
 /**
  * Draw the score, the grid, and the cells.
  */
-void ui_render_game_state(void)
+void ui_render_game_state(const struct game *g)
 {
 	int i;
 
 	if (screen_too_small)
 		goto ret;
 
+	/* Fall back to the dashboard when we don't have the room */
+	if (compact) {
+		ui_render_dashboard(g, 1);
+		return;
+	}
+
 	if (!rendered_grid) draw_grid();
 	if (colors) attron(COLOR_PAIR(1));
 
 #ifdef DEBUG
-	draw_debug();
+	draw_debug(g);
 #endif
 
-	if (game_state == GAME_WON) {
+	if (g->game_state == GAME_WON) {
 		beep();
 		attron(A_BLINK);
 		mvaddstr(row0, col0, "YOU WIN  ");
 		attroff(A_BLINK);
 		mvaddstr(row0 + HEIGHT - 2, col0, instructions[2]);
 		mvaddstr(row0 + HEIGHT - 1, col0, instructions[3]);
-	} else if (game_state == GAME_OVER) {
+	} else if (g->game_state == GAME_OVER) {
 		beep();
 		mvaddstr(row0, col0, "GAME OVER");
 		mvaddstr(row0 + HEIGHT - 2, col0, instructions[2]);
@@ -399,17 +485,54 @@ void ui_render_game_state(void)
 	} else {
 		move(row0, col0);
 		clrtoeol();
-		mvaddstr(row0, col0, numbers[game_type]);
+		mvaddstr(row0, col0, numbers[g->game_type]);
 		mvaddstr(row0 + HEIGHT - 2, col0, instructions[0]);
 		mvaddstr(row0 + HEIGHT - 1, col0, instructions[1]);
 	}
 
-	mvaddstr(row0, col0 + WIDTH - SCORE_SIZE, score);
+	mvaddstr(row0, col0 + WIDTH - SCORE_SIZE, g->score);
 	if (colors) attroff(COLOR_PAIR(1));
 
 	/* Draw the cells */
 	for (i = 0; i < 16; i++)
-		draw_cell(i);
+		draw_cell(g, i);
+ret:
+	refresh();
+}
+
+/**
+ * Draw a number of games side-by-side, in compact form.
+ */
+void ui_render_dashboard(const struct game *games, int count)
+{
+	unsigned char board[PACKED_BOARD_SIZE];
+	int i, row, col, per_row = COLS / MINI_WIDTH;
+
+	if (screen_too_small || !per_row)
+		goto ret;
+
+	if (count > DASHBOARD_MAX)
+		count = DASHBOARD_MAX;
+
+	for (i = 0; i < count; i++) {
+		row = (i / per_row) * MINI_HEIGHT;
+		col = (i % per_row) * MINI_WIDTH;
+		if (row + MINI_HEIGHT - 1 > LINES) break;
+
+		/* Skip boards that haven't changed */
+		game_pack_board(&games[i], board);
+		if (shown[i].drawn &&
+		    shown[i].game_state == games[i].game_state &&
+		    !memcmp(shown[i].board, board, sizeof(board)) &&
+		    !strcmp(shown[i].score, games[i].score))
+			continue;
+
+		draw_mini(&games[i], row, col);
+		memcpy(shown[i].board, board, sizeof(board));
+		strcpy(shown[i].score, games[i].score);
+		shown[i].game_state = games[i].game_state;
+		shown[i].drawn = 1;
+	}
 ret:
 	refresh();
 }
@@ -11,10 +11,14 @@
 /* Non-zero if the display has colors and the user wants colors */
 extern int colors;
 
+struct game;
+
 /**
  * Initialize the UI.
+ *
+ * \param[in] g Game state to render (or NULL.)
  */
-void ui_init(void);
+void ui_init(const struct game *g);
 
 /**
  * Detect changes in the window size.
@@ -23,8 +27,21 @@ void ui_window_size_changed(void);
 
 /**
  * Draw the score, the grid, and the cells.
+ *
+ * \param[in] g Game state to render.
+ */
+void ui_render_game_state(const struct game *g);
+
+/**
+ * Draw a number of games side-by-side, in compact form.
+ *
+ * Only boards that changed since they were last drawn are
+ * redrawn. Boards that don't fit on the screen are skipped.
+ *
+ * \param[in] games Array of games to render.
+ * \param[in] count Number of games in the array.
  */
-void ui_render_game_state(void);
+void ui_render_dashboard(const struct game *games, int count);
 
 /**
  * Uninitialize the UI.
@@ -0,0 +1,160 @@
+/**
+ * tp2 - Environment Check
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ *
+ * Drives batches of environments from libtp2.a, as a trainer
+ * would, in each observation format, and checks every step
+ * against the same move made directly with game_move().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "env.h"
+#include "stats.h"
+
+/* Environments in each batch */
+#define ENVS 32
+
+/* Steps to take in each batch */
+#define STEPS 2000
+
+/* Every so often, take an action that isn't a move. */
+#define NONE_EVERY 97
+
+/**
+ * Check that an observation matches a game's board.
+ *
+ * \param[in] g      Game state.
+ * \param[in] format Observation format (OBS_*.)
+ * \param[in] obs    Observation.
+ * \return 1 if it matches, 0 otherwise.
+ */
+static int check_obs(const struct game *g, int format,
+                     const unsigned char *obs)
+{
+	int i, e;
+
+	for (i = 0; i < BOARD_WIDTH * BOARD_HEIGHT; i++) {
+		if (format == OBS_LOG2) {
+			if (obs[i] != (g->board[i] & 0x0f)) return 0;
+			continue;
+		}
+
+		/* Exactly one plane is set for each cell. */
+		for (e = 0; e < 16; e++) {
+			if (obs[e * BOARD_WIDTH * BOARD_HEIGHT + i] !=
+			    (e == (g->board[i] & 0x0f)))
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * Run a batch of environments, and gather their statistics.
+ *
+ * \param[in]  format Observation format (OBS_*.)
+ * \param[out] s      Statistics.
+ * \return The number of mismatches found.
+ */
+static unsigned long run(int format, struct stats *s)
+{
+	static unsigned char obs[ENVS * OBS_SIZE(OBS_ONEHOT)];
+	struct env envs[ENVS];
+	struct game prev[ENVS], g;
+	unsigned long rewards[ENVS], points[ENVS], moves[ENVS];
+	unsigned long rng = 1, bad = 0;
+	unsigned char dones[ENVS], masks[ENVS];
+	int actions[ENVS], i, step;
+	size_t size = (size_t)OBS_SIZE(format);
+
+	memset(s, 0, sizeof(*s));
+	for (i = 0; i < ENVS; i++) {
+		env_init(&envs[i], 11, format, (unsigned long)i + 1,
+		         obs + size * (size_t)i);
+		bad += !check_obs(&envs[i].game, format,
+		                  obs + size * (size_t)i);
+		masks[i] = (unsigned char)game_legal_moves(&envs[i].game);
+		points[i] = moves[i] = 0;
+	}
+
+	for (step = 0; step < STEPS; step++) {
+		/* Pick a random legal action (or none) for each. */
+		for (i = 0; i < ENVS; i++) {
+			prev[i] = envs[i].game;
+			rng = (rng * 1103515245UL + 12345UL) & 0xffffffffUL;
+			actions[i] = (int)((rng >> 16) & 3);
+			while (masks[i] && !(masks[i] & (1 << actions[i])))
+				actions[i] = (actions[i] + 1) & 3;
+			if (!((step + i) % NONE_EVERY))
+				actions[i] = MOVE_NONE;
+		}
+
+		env_step_batch(envs, ENVS, actions, obs, rewards, dones, masks);
+
+		for (i = 0; i < ENVS; i++) {
+			g = prev[i];
+			game_move(&g, actions[i]);
+
+			bad += rewards[i] != g.reward;
+			bad += dones[i] != g.game_state;
+			bad += masks[i] != game_legal_moves(&envs[i].game);
+			bad += !check_obs(&envs[i].game, format,
+			                  obs + size * (size_t)i);
+			if (!dones[i]) {
+				bad += memcmp(g.board, envs[i].game.board,
+				              sizeof(g.board)) != 0;
+			}
+
+			/* Not moving scores nothing, and changes nothing. */
+			if (actions[i] == MOVE_NONE) {
+				bad += rewards[i] != 0;
+				bad += prev[i].rng != envs[i].game.rng;
+				continue;
+			}
+
+			stats_add_move(s, &g);
+			points[i] += g.reward;
+			moves[i]++;
+
+			if (dones[i]) {
+				stats_add_game(s, &g, points[i], moves[i]);
+				points[i] = moves[i] = 0;
+			}
+		}
+	}
+
+	return bad;
+}
+
+int main(void)
+{
+	struct stats log2, onehot, total;
+	unsigned long bad;
+
+	bad = run(OBS_LOG2, &log2);
+	bad += run(OBS_ONEHOT, &onehot);
+
+	memset(&total, 0, sizeof(total));
+	stats_merge(&total, &log2);
+	stats_merge(&total, &onehot);
+	bad += total.games != log2.games + onehot.games;
+	bad += total.moves != log2.moves + onehot.moves;
+	stats_write(&total, stdout, 0);
+
+	if (bad) {
+		fprintf(stderr, "error: %lu mismatches between the "
+		        "environments and the game.\n", bad);
+		return EXIT_FAILURE;
+	}
+
+	puts("The environments matched the game in both formats.");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,920 @@
+/**
+ * tp2 - State Space Explorer
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ *
+ * Counts every board that can come up in a game type, breadth first,
+ * one layer at a time, a layer being every board with the same sum of
+ * tiles: a move keeps the sum, and the tile added after it raises the
+ * sum by 2 or 4, so every successor of a layer is in it, or in one of
+ * the next two.
+ *
+ * Boards are kept on disk, packed (see game_pack_board()), so the
+ * memory used is bounded by -m rather than by the number of boards.
+ * The worker processes each expand their share of a layer, and spill
+ * the successors into temporary files in sorted, de-duplicated runs.
+ * The runs bound for each layer are then merged (k ways) into one
+ * sorted file, dropping duplicates, which is the layer.
+ *
+ * A move that leaves only cell 0 free adds no tile (see
+ * add_random_tile()), so its board is in the same layer: those are
+ * merged back into the layer until no new boards turn up.
+ *
+ * Boards holding the winning tile, or with no move left, are counted
+ * but not expanded, as the game ends there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "game.h"
+
+/* Maximum number of worker processes */
+#define MAX_WORKERS 64
+
+/* Size of a board, packed */
+#define KEY PACKED_BOARD_SIZE
+
+/* Smallest buffer to read a run through (in boards) */
+#define MIN_READ 256
+
+/* Smallest buffer to spill runs from (in boards) */
+#define MIN_SPILL 4096
+
+/**
+ * Runs bound for a layer: from the layer two below, the layer four
+ * below, and the start of the game.
+ */
+#define MAX_PENDING (2 * MAX_WORKERS + 1)
+
+/**
+ * A sorted run of boards in a file, read through a buffer.
+ * Workers read their share of a layer the same way.
+ */
+struct run {
+	int fd;
+	unsigned long off;   /* Offset of the next board to read */
+	unsigned long left;  /* Boards not read into the buffer yet */
+	unsigned char *buf;
+	size_t pos, len, cap;
+};
+
+/**
+ * Successors of the boards being expanded, by how much they
+ * raise the tile sum (0, 2 or 4), waiting to be spilled as runs.
+ */
+struct spill {
+	FILE *fp[3];
+	unsigned char *buf[3];
+	size_t n[3], cap;
+	unsigned long added[3];
+};
+
+/* What a worker sends back */
+struct summary {
+	unsigned long expanded;
+	unsigned long successors[3]; /* By layer (0, 1 or 2 above) */
+};
+
+/* Files holding runs bound for a layer, and the boards in them */
+struct pending {
+	FILE *fp[MAX_PENDING];
+	int n;
+	unsigned long boards;
+};
+
+/* Game type, workers, and memory to use (in bytes) */
+static int type = 5, workers = 1;
+static unsigned long memory = 256UL << 20;
+
+/* Runs bound for this layer, and the next two */
+static struct pending pending[3];
+
+/**
+ * Show usage information.
+ */
+static void usage(char *argv0)
+{
+	printf("Usage: %s [-j workers] [-m megabytes] game_type\n", argv0);
+	puts("\t-j workers:   Number of processes (default: 1)");
+	puts("\t-m megabytes: Memory to use for sorting and merging "
+	     "(default: 256)\n");
+	puts("\tEvery board that can come up on the way to 2^game_type");
+	printf("\ton a %dx%d board is counted.\n", BOARD_WIDTH, BOARD_HEIGHT);
+}
+
+/**
+ * Get the wall-clock time in seconds.
+ *
+ * \return The time.
+ */
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+/**
+ * Compare two packed boards, for qsort().
+ */
+static int compare_keys(const void *a, const void *b)
+{
+	return memcmp(a, b, KEY);
+}
+
+/**
+ * Read exactly len bytes from a file, at an offset.
+ *
+ * \param[in]  fd  File descriptor.
+ * \param[out] buf Buffer.
+ * \param[in]  len Bytes to read.
+ * \param[in]  off Offset to read from.
+ * \return 0 on success, -1 on error.
+ */
+static int read_at(int fd, void *buf, size_t len, unsigned long off)
+{
+	ssize_t n;
+
+	while (len) {
+		if ((n = pread(fd, buf, len, (off_t)off)) <= 0) return -1;
+		buf = (char *)buf + n;
+		len -= (size_t)n;
+		off += (unsigned long)n;
+	}
+
+	return 0;
+}
+
+/**
+ * Set up a run.
+ *
+ * \param[out] r     Run.
+ * \param[in]  fd    File descriptor.
+ * \param[in]  off   Offset of its first board.
+ * \param[in]  count Number of boards.
+ * \param[in]  cap   Boards to buffer.
+ * \return 0 on success, -1 on error.
+ */
+static int run_open(struct run *r, int fd, unsigned long off,
+                    unsigned long count, size_t cap)
+{
+	r->fd = fd;
+	r->off = off;
+	r->left = count;
+	r->pos = r->len = 0;
+	r->cap = cap;
+	return (r->buf = malloc(cap * KEY)) ? 0 : -1;
+}
+
+/**
+ * Get the next board in a run, without taking it.
+ *
+ * \param[in] r   Run.
+ * \param[in] err Set to -1 on a read error.
+ * \return The board, or NULL if there are none left.
+ */
+static const unsigned char *run_peek(struct run *r, int *err)
+{
+	if (r->pos == r->len) {
+		if (!r->left) return NULL;
+
+		r->pos = 0;
+		r->len = r->left < r->cap ? (size_t)r->left : r->cap;
+		if (read_at(r->fd, r->buf, r->len * KEY, r->off)) {
+			*err = -1;
+			r->left = r->len = 0;
+			return NULL;
+		}
+
+		r->off += (unsigned long)(r->len * KEY);
+		r->left -= (unsigned long)r->len;
+	}
+
+	return r->buf + r->pos * KEY;
+}
+
+/**
+ * Find the runs a spill file holds.
+ *
+ * Each run is a count of boards (an unsigned long), then the
+ * boards themselves.
+ *
+ * \param[in]     fp   Spill file.
+ * \param[in,out] runs Runs found so far.
+ * \param[in,out] n    Number of runs.
+ * \param[in,out] max  Size of the runs array.
+ * \return 0 on success, -1 on error.
+ */
+static int find_runs(FILE *fp, struct run **runs, int *n, int *max)
+{
+	int fd = fileno(fp);
+	unsigned long off = 0, count;
+	off_t end = lseek(fd, 0, SEEK_END);
+	struct run *r;
+
+	if (end == (off_t)-1) return -1;
+	while (off < (unsigned long)end) {
+		if (read_at(fd, &count, sizeof(count), off)) return -1;
+		off += sizeof(count);
+
+		if (*n == *max) {
+			*max = *max ? *max * 2 : 64;
+			if (!(r = realloc(*runs, (size_t)*max * sizeof(*r))))
+				return -1;
+			*runs = r;
+		}
+
+		r = *runs + (*n)++;
+		r->fd = fd;
+		r->off = off;
+		r->left = count;
+		r->buf = NULL;
+		off += count * KEY;
+	}
+
+	return 0;
+}
+
+/**
+ * Move a run down the heap, until its next board is no greater
+ * than those of the runs below it.
+ *
+ * \param[in]     runs Runs.
+ * \param[in,out] heap Heap of runs, by their next board.
+ * \param[in]     n    Runs in the heap.
+ * \param[in]     i    Where the run is in the heap.
+ * \param[out]    err  Set to -1 on a read error.
+ */
+static void sift_down(struct run *runs, int *heap, int n, int i, int *err)
+{
+	int c, t;
+
+	for (c = 2 * i + 1; c < n; i = c, c = 2 * i + 1) {
+		if (c + 1 < n && memcmp(run_peek(&runs[heap[c + 1]], err),
+		                        run_peek(&runs[heap[c]], err), KEY) < 0)
+			c++;
+		if (memcmp(run_peek(&runs[heap[c]], err),
+		           run_peek(&runs[heap[i]], err), KEY) >= 0)
+			break;
+
+		t = heap[i];
+		heap[i] = heap[c];
+		heap[c] = t;
+	}
+}
+
+/**
+ * Merge sorted runs into a file, dropping duplicates, and any
+ * board that's also in another run.
+ *
+ * \param[in]  runs  Runs to merge (their buffers are allocated here.)
+ * \param[in]  n     Number of runs.
+ * \param[in]  minus Sorted boards to leave out (likewise), or NULL.
+ * \param[in]  out   File to write the boards to.
+ * \param[out] count Number of boards written.
+ * \return NULL on success, error message on error.
+ */
+static const char *merge_runs(struct run *runs, int n, struct run *minus,
+                              FILE *out, unsigned long *count)
+{
+	unsigned char last[KEY];
+	const unsigned char *k, *m = NULL;
+	size_t cap = memory / KEY / (size_t)(n + 1);
+	const char *err = NULL;
+	int i, h = 0, *heap, ioerr = 0, have_last = 0;
+
+	*count = 0;
+	if (cap < MIN_READ) cap = MIN_READ;
+	if (!(heap = malloc((size_t)(n + 1) * sizeof(*heap))))
+		return "unable to allocate the merge buffers";
+
+	for (i = 0; i < n; i++) {
+		if (run_open(&runs[i], runs[i].fd, runs[i].off, runs[i].left,
+		             cap)) {
+			err = "unable to allocate the merge buffers";
+			goto ret;
+		}
+		if (run_peek(&runs[i], &ioerr)) heap[h++] = i;
+	}
+
+	if (minus) {
+		if (run_open(minus, minus->fd, minus->off, minus->left, cap)) {
+			minus = NULL;
+			err = "unable to allocate the merge buffers";
+			goto ret;
+		}
+		m = run_peek(minus, &ioerr);
+	}
+
+	for (i = h / 2 - 1; i >= 0; i--)
+		sift_down(runs, heap, h, i, &ioerr);
+
+	while (h && !ioerr) {
+		k = run_peek(&runs[heap[0]], &ioerr);
+		if (!have_last || memcmp(k, last, KEY)) {
+			while (m && memcmp(m, k, KEY) < 0) {
+				minus->pos++;
+				m = run_peek(minus, &ioerr);
+			}
+
+			if (!m || memcmp(m, k, KEY)) {
+				if (fwrite(k, KEY, 1, out) != 1) {
+					err = "unable to write a layer";
+					goto ret;
+				}
+				(*count)++;
+			}
+			memcpy(last, k, KEY);
+			have_last = 1;
+		}
+
+		runs[heap[0]].pos++;
+		if (!run_peek(&runs[heap[0]], &ioerr))
+			heap[0] = heap[--h];
+		sift_down(runs, heap, h, 0, &ioerr);
+	}
+
+	if (ioerr) err = "unable to read a run";
+	else if (fflush(out)) err = "unable to write a layer";
+
+ret:
+	for (i = 0; i < n; i++) {
+		free(runs[i].buf);
+		runs[i].buf = NULL;
+	}
+	if (minus) free(minus->buf);
+	free(heap);
+	return err;
+}
+
+/**
+ * Merge every run in a set of spill files.
+ *
+ * \param[in]  fp    Spill files.
+ * \param[in]  n     Number of files.
+ * \param[in]  minus Boards to leave out, or NULL.
+ * \param[in]  out   File to write the boards to.
+ * \param[out] count Number of boards written.
+ * \return NULL on success, error message on error.
+ */
+static const char *merge_files(FILE **fp, int n, struct run *minus,
+                               FILE *out, unsigned long *count)
+{
+	struct run *runs = NULL;
+	const char *err = NULL;
+	int i, r = 0, max = 0;
+
+	for (i = 0; i < n; i++) {
+		if (find_runs(fp[i], &runs, &r, &max)) {
+			err = "unable to read a run";
+			goto ret;
+		}
+	}
+
+	err = merge_runs(runs, r, minus, out, count);
+
+ret:
+	free(runs);
+	return err;
+}
+
+/**
+ * Spill the successors buffered for one layer as a run.
+ *
+ * \param[in] sp Spill.
+ * \param[in] i  Which layer (0, 1 or 2 above.)
+ * \return 0 on success, -1 on error.
+ */
+static int spill_flush(struct spill *sp, int i)
+{
+	unsigned char *b = sp->buf[i];
+	unsigned long count;
+	size_t j, n = 0;
+
+	if (!sp->n[i]) return 0;
+	qsort(b, sp->n[i], KEY, compare_keys);
+	for (j = 0; j < sp->n[i]; j++) {
+		if (n && !memcmp(b + j * KEY, b + (n - 1) * KEY, KEY))
+			continue;
+		if (n != j) memcpy(b + n * KEY, b + j * KEY, KEY);
+		n++;
+	}
+
+	count = (unsigned long)n;
+	sp->n[i] = 0;
+	if (fwrite(&count, sizeof(count), 1, sp->fp[i]) != 1 ||
+	    fwrite(b, KEY, n, sp->fp[i]) != n)
+		return -1;
+	return 0;
+}
+
+/**
+ * Add a board to a spill.
+ *
+ * \param[in] sp Spill.
+ * \param[in] g  Board.
+ * \param[in] i  Which layer it's in (0, 1 or 2 above.)
+ * \return 0 on success, -1 on error.
+ */
+static int spill_add(struct spill *sp, const struct game *g, int i)
+{
+	if (sp->n[i] == sp->cap && spill_flush(sp, i)) return -1;
+	game_pack_board(g, sp->buf[i] + sp->n[i]++ * KEY);
+	sp->added[i]++;
+	return 0;
+}
+
+/**
+ * Set up a spill.
+ *
+ * \param[out] sp  Spill.
+ * \param[in]  fp  Files to spill to, for each layer.
+ * \param[in]  cap Boards to buffer for each layer.
+ * \return 0 on success, -1 on error.
+ */
+static int spill_open(struct spill *sp, FILE **fp, size_t cap)
+{
+	int i;
+
+	sp->cap = cap;
+	for (i = 0; i < 3; i++) {
+		sp->fp[i] = fp[i];
+		sp->n[i] = 0;
+		sp->added[i] = 0;
+		if (!(sp->buf[i] = malloc(cap * KEY))) return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Spill every board buffered, and make sure it's written.
+ *
+ * \param[in] sp Spill.
+ * \return 0 on success, -1 on error.
+ */
+static int spill_close(struct spill *sp)
+{
+	int i, ret = 0;
+
+	for (i = 0; i < 3; i++) {
+		if (spill_flush(sp, i) || fflush(sp->fp[i])) ret = -1;
+		free(sp->buf[i]);
+		sp->buf[i] = NULL;
+	}
+
+	return ret;
+}
+
+/**
+ * Add every successor of a board to a spill.
+ *
+ * \param[in] g  Board.
+ * \param[in] sp Spill.
+ * \return 0 on success, -1 on error.
+ */
+static int expand(const struct game *g, struct spill *sp)
+{
+	struct game t, u;
+	int move, c;
+
+	for (move = MOVE_UP; move <= MOVE_RIGHT; move++) {
+		t = *g;
+		if (!game_slide(&t, move)) continue;
+
+		/* Nowhere to add a tile: the board stays in its layer. */
+		if (!(t.board_state & ~1)) {
+			if (spill_add(sp, &t, 0)) return -1;
+			continue;
+		}
+
+		for (c = 1; c < BOARD_WIDTH * BOARD_HEIGHT; c++) {
+			if (t.board[c]) continue;
+
+			u = t;
+			game_place_tile(&u, c, 1);
+			if (spill_add(sp, &u, 1)) return -1;
+
+			u = t;
+			game_place_tile(&u, c, 2);
+			if (spill_add(sp, &u, 2)) return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Expand a worker's share of some boards.
+ *
+ * \param[in]  fd    Sorted boards.
+ * \param[in]  first First board of the share.
+ * \param[in]  count Boards in the share.
+ * \param[in]  fp    Files to spill to, for each layer.
+ * \param[out] s     Summary.
+ * \return 0 on success, -1 on error.
+ */
+static int work(int fd, unsigned long first, unsigned long count,
+                FILE **fp, struct summary *s)
+{
+	size_t cap = memory / (size_t)workers / KEY / 4;
+	const unsigned char *k;
+	struct game g;
+	struct spill sp;
+	struct run r;
+	int c, err = 0;
+
+	if (cap < MIN_SPILL) cap = MIN_SPILL;
+	if (run_open(&r, fd, first * KEY, count, cap) ||
+	    spill_open(&sp, fp, cap))
+		return -1;
+
+	init_game_state(&g, type, 0);
+	while (!err && (k = run_peek(&r, &err))) {
+		r.pos++;
+		game_unpack_board(&g, k);
+
+		/* The game ends at the winning tile, or with no move left. */
+		for (c = 0; c < BOARD_WIDTH * BOARD_HEIGHT; c++)
+			if (g.board[c] >= type) break;
+		if (c < BOARD_WIDTH * BOARD_HEIGHT || game_is_over(&g))
+			continue;
+
+		if (expand(&g, &sp)) err = -1;
+		s->expanded++;
+	}
+
+	for (c = 0; c < 3; c++)
+		s->successors[c] = sp.added[c];
+	if (spill_close(&sp)) err = -1;
+	free(r.buf);
+	return err;
+}
+
+/**
+ * Add one summary to another.
+ *
+ * \param[in,out] total Summary to add to.
+ * \param[in]     s     Summary to add.
+ */
+static void summary_add(struct summary *total, const struct summary *s)
+{
+	int i;
+
+	total->expanded += s->expanded;
+	for (i = 0; i < 3; i++)
+		total->successors[i] += s->successors[i];
+}
+
+/**
+ * Read a whole summary from a worker.
+ *
+ * \param[in]  fd Pipe from the worker.
+ * \param[out] s  Summary.
+ * \return 1 if it was read, 0 otherwise.
+ */
+static int read_summary(int fd, struct summary *s)
+{
+	size_t got = 0;
+	ssize_t n;
+
+	while (got < sizeof(*s)) {
+		n = read(fd, (char *)s + got, sizeof(*s) - got);
+		if (n <= 0) return 0;
+		got += (size_t)n;
+	}
+
+	return 1;
+}
+
+/**
+ * Expand some boards, split between the workers.
+ *
+ * \param[in]  fp    Sorted boards (no run header.)
+ * \param[in]  count Number of boards.
+ * \param[in]  out   Files to spill to, for each layer and worker.
+ * \param[out] total Summary.
+ * \return NULL on success, error message on error.
+ */
+static const char *expand_all(FILE *fp, unsigned long count,
+                              FILE *out[3][MAX_WORKERS],
+                              struct summary *total)
+{
+	int fds[MAX_WORKERS];
+	const char *err = NULL;
+	struct summary s;
+	unsigned long first;
+	FILE *files[3];
+	int w, i, got = 0, fd[2];
+	pid_t pid;
+
+	memset(total, 0, sizeof(*total));
+	for (w = 0; w < workers; w++) {
+		if (pipe(fd)) {
+			err = "unable to start a worker";
+			break;
+		}
+
+		if (!(pid = fork())) {
+			close(fd[0]);
+			for (i = 0; i < 3; i++)
+				files[i] = out[i][w];
+			first = count * (unsigned long)w / (unsigned long)workers;
+
+			memset(&s, 0, sizeof(s));
+			if (work(fileno(fp), first, count * (unsigned long)(w + 1) /
+			         (unsigned long)workers - first, files, &s) ||
+			    write(fd[1], &s, sizeof(s)) != sizeof(s))
+				_exit(EXIT_FAILURE);
+			_exit(EXIT_SUCCESS);
+		}
+
+		close(fd[1]);
+		if (pid == -1) {
+			close(fd[0]);
+			err = "unable to start a worker";
+			break;
+		}
+		fds[w] = fd[0];
+	}
+
+	while (w--) {
+		if (read_summary(fds[w], &s)) {
+			summary_add(total, &s);
+			got++;
+		}
+		close(fds[w]);
+	}
+	while (wait(NULL) > 0);
+
+	if (!err && got != workers)
+		err = "a worker failed to expand its boards";
+	return err;
+}
+
+/**
+ * Get the peak memory used, in kilobytes.
+ *
+ * \param[in] who RUSAGE_SELF or RUSAGE_CHILDREN.
+ * \return The peak resident set size.
+ */
+static long peak_rss(int who)
+{
+	struct rusage ru;
+
+	return getrusage(who, &ru) ? 0 : ru.ru_maxrss;
+}
+
+/**
+ * Write the boards a game can start with, as runs bound for
+ * the first three layers.
+ *
+ * \return NULL on success, error message on error.
+ */
+static const char *start(void)
+{
+	unsigned char packed[PACKED_BOARD_SIZE];
+	struct game g, empty;
+	struct spill sp;
+	FILE *fp[3];
+	int i, c1, c2, e1, e2, err = 0;
+
+	for (i = 0; i < 3; i++) {
+		if (!(fp[i] = tmpfile()))
+			return "unable to create a spill file";
+		pending[(2 + i) % 3].fp[pending[(2 + i) % 3].n++] = fp[i];
+	}
+
+	if (spill_open(&sp, fp, MIN_SPILL))
+		return "unable to allocate the spill buffers";
+
+	memset(packed, 0, sizeof(packed));
+	init_game_state(&empty, type, 0);
+	game_unpack_board(&empty, packed);
+
+	/* Games start with two tiles, added as any other. */
+	for (c1 = 1; c1 < BOARD_WIDTH * BOARD_HEIGHT; c1++) {
+		for (c2 = 1; c2 < BOARD_WIDTH * BOARD_HEIGHT; c2++) {
+			if (c1 == c2) continue;
+			for (e1 = 1; e1 <= 2; e1++) {
+				for (e2 = 1; e2 <= 2; e2++) {
+					g = empty;
+					game_place_tile(&g, c1, e1);
+					game_place_tile(&g, c2, e2);
+					if (spill_add(&sp, &g, e1 + e2 - 2)) err = -1;
+				}
+			}
+		}
+	}
+
+	for (i = 0; i < 3; i++)
+		pending[(2 + i) % 3].boards += sp.added[i];
+	if (spill_close(&sp) || err)
+		return "unable to write a spill file";
+	return NULL;
+}
+
+/**
+ * Add new boards to a layer, keeping it sorted.
+ *
+ * \param[in,out] layer Layer file (replaced by a new one.)
+ * \param[in,out] count Boards in the layer.
+ * \param[in]     fp    Sorted boards, none of them in the layer.
+ * \param[in]     added Number of boards in fp.
+ * \return NULL on success, error message on error.
+ */
+static const char *add_to_layer(FILE **layer, unsigned long *count,
+                                FILE *fp, unsigned long added)
+{
+	struct run both[2];
+	const char *err;
+	FILE *out;
+
+	if (!(out = tmpfile()))
+		return "unable to create a layer file";
+
+	both[0].fd = fileno(*layer);
+	both[0].off = 0;
+	both[0].left = *count;
+	both[1].fd = fileno(fp);
+	both[1].off = 0;
+	both[1].left = added;
+	both[0].buf = both[1].buf = NULL;
+	if ((err = merge_runs(both, 2, NULL, out, count))) {
+		fclose(out);
+		return err;
+	}
+
+	fclose(*layer);
+	*layer = out;
+	return NULL;
+}
+
+/**
+ * Explore one layer, including the boards in it that follow
+ * from others in it.
+ *
+ * \param[in]  sum   Tile sum of the layer.
+ * \param[out] count Boards in the layer.
+ * \param[out] total Summary of expanding it.
+ * \return NULL on success, error message on error.
+ */
+static const char *explore(unsigned long sum, unsigned long *count,
+                           struct summary *total)
+{
+	struct pending *p = &pending[sum / 2 % 3];
+	FILE *out[3][MAX_WORKERS], *layer, *frontier = NULL, *fp;
+	const char *err = NULL;
+	unsigned long n;
+	struct summary s;
+	struct run minus;
+	int w, i;
+
+	memset(out, 0, sizeof(out));
+	memset(total, 0, sizeof(*total));
+	if (!(layer = tmpfile()))
+		return "unable to create a layer file";
+
+	err = merge_files(p->fp, p->n, NULL, layer, count);
+	while (p->n) fclose(p->fp[--p->n]);
+	p->boards = 0;
+	if (err) goto ret;
+
+	/* Successors in the next two layers wait for them. */
+	for (i = 1; i < 3; i++) {
+		p = &pending[(sum / 2 + (unsigned long)i) % 3];
+		for (w = 0; w < workers; w++) {
+			if (!(out[i][w] = tmpfile())) {
+				err = "unable to create a spill file";
+				goto ret;
+			}
+			p->fp[p->n++] = out[i][w];
+		}
+	}
+
+	for (n = *count; n; ) {
+		for (w = 0; w < workers; w++) {
+			if (!(out[0][w] = tmpfile())) {
+				err = "unable to create a spill file";
+				goto ret;
+			}
+		}
+
+		err = expand_all(frontier ? frontier : layer, n, out, &s);
+		if (frontier) fclose(frontier);
+		frontier = NULL;
+		if (err) goto ret;
+		summary_add(total, &s);
+		for (i = 1; i < 3; i++)
+			pending[(sum / 2 + (unsigned long)i) % 3].boards +=
+				s.successors[i];
+
+		/* Keep the boards that are new to this layer, and expand them. */
+		if (!(fp = tmpfile())) {
+			err = "unable to create a layer file";
+			goto ret;
+		}
+
+		minus.fd = fileno(layer);
+		minus.off = 0;
+		minus.left = *count;
+		err = merge_files(out[0], workers, &minus, fp, &n);
+		for (w = 0; w < workers; w++) {
+			fclose(out[0][w]);
+			out[0][w] = NULL;
+		}
+
+		if (!err && n) err = add_to_layer(&layer, count, fp, n);
+		if (err || !n) fclose(fp);
+		else frontier = fp;
+		if (err) goto ret;
+	}
+
+ret:
+	for (w = 0; w < workers; w++)
+		if (out[0][w]) fclose(out[0][w]);
+	if (frontier) fclose(frontier);
+	fclose(layer);
+	return err;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *err = NULL;
+	unsigned long sum, count, n, boards = 0, successors = 0;
+	struct summary s;
+	double begin, t;
+	int i;
+
+	/* Handle args: options, then the game type */
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		switch (argv[i][1]) {
+		case 'j': /* -j: Worker processes */
+			workers = atoi(argv[i + 1]);
+			if (workers < 1 || workers > MAX_WORKERS) {
+				err = "the number of workers must be between 1 and 64.";
+				goto err;
+			}
+			break;
+		case 'm': /* -m: Memory, in megabytes */
+			memory = strtoul(argv[i + 1], NULL, 10);
+			if (memory < 1 || memory > 4095) {
+				err = "the memory must be between 1 and 4095 MB.";
+				goto err;
+			}
+			memory <<= 20;
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (i != argc - 1 || (type = atoi(argv[i])) < 2 || type > 15) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if ((err = start())) goto err;
+
+	/* Carry on until no boards are waiting for any layer. */
+	begin = now();
+	for (sum = 4; pending[0].boards || pending[1].boards ||
+	              pending[2].boards; sum += 2) {
+		t = now();
+		if ((err = explore(sum, &count, &s))) goto err;
+		t = now() - t;
+
+		n = s.successors[0] + s.successors[1] + s.successors[2];
+		boards += count;
+		successors += n;
+		printf("sum=%lu boards=%lu expanded=%lu successors=%lu "
+		       "time=%.2fs boards/s=%.0f rss=%ldK workers_rss=%ldK\n",
+		       sum, count, s.expanded, n, t,
+		       t > 0.0 ? (double)count / t : 0.0,
+		       peak_rss(RUSAGE_SELF), peak_rss(RUSAGE_CHILDREN));
+		fflush(stdout);
+	}
+
+	t = now() - begin;
+	printf("total boards=%lu successors=%lu time=%.2fs boards/s=%.0f\n",
+	       boards, successors, t, t > 0.0 ? (double)boards / t : 0.0);
+
+err:
+	if (err) {
+		fprintf(stderr, "error: %s\n", err);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/**
+ * tp2 - Move Table Generator
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ *
+ * Writes the C source for the tables declared in tables.h to
+ * stdout. It must be built with the same BOARD_WIDTH and
+ * BOARD_HEIGHT as tp2.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "game.h"
+#include "line.h"
+#include "tables.h"
+
+#ifdef HAVE_ROW_TABLES
+/**
+ * Write the tables for lines of the given length.
+ *
+ * \param[in] name Prefix for the names of the tables.
+ * \param[in] len  Number of cells on a line.
+ */
+static void write_tables(const char *name, int len)
+{
+	unsigned long line, entries = 1UL << (len << 2);
+	int merged;
+
+	printf("\nconst unsigned short %s_moves[%lu] = {", name, entries);
+	for (line = 0; line < entries; line++) {
+		printf("%s0x%04x%s", line % 8 ? " " : "\n\t",
+		       line_move((unsigned int)line, len, &merged),
+		       line + 1 < entries ? "," : "\n");
+	}
+	puts("};");
+
+	printf("\nconst signed char %s_merges[%lu] = {", name, entries);
+	for (line = 0; line < entries; line++) {
+		line_move((unsigned int)line, len, &merged);
+		printf("%s%2d%s", line % 16 ? " " : "\n\t", merged,
+		       line + 1 < entries ? "," : "\n");
+	}
+	puts("};");
+}
+#endif
+
+int main(void)
+{
+	puts("/**\n * tp2 - Move Tables\n *");
+	printf(" * Generated by tools/mktables for a %dx%d board.\n",
+	       BOARD_WIDTH, BOARD_HEIGHT);
+	puts(" * Don't edit this file, run make instead.\n */\n");
+	puts("#include \"game.h\"\n#include \"tables.h\"\n");
+	printf("#if BOARD_WIDTH != %d || BOARD_HEIGHT != %d\n",
+	       BOARD_WIDTH, BOARD_HEIGHT);
+	puts("#error \"The tables were generated for another board size.\"");
+	puts("#endif");
+
+#ifdef HAVE_ROW_TABLES
+	write_tables("row", BOARD_WIDTH);
+#if BOARD_WIDTH != BOARD_HEIGHT
+	write_tables("column", BOARD_HEIGHT);
+#endif
+#else
+	/* An empty translation unit isn't valid C. */
+	puts("\ntypedef int no_tables;");
+#endif
+
+	return fflush(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
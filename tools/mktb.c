@@ -0,0 +1,315 @@
+/**
+ * tp2 - Tablebase Generator
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ *
+ * Works out the chance of winning, with the best play, from every
+ * position reachable in a game type, on the size of board it was
+ * built for, and writes them to a tablebase (see src/tablebase.h.)
+ *
+ * The positions are searched depth first from every way a game
+ * can start, remembering the value of each position, so each is
+ * only solved once. A position's value is the best, over its
+ * moves, of the chance of winning once the move is made and a
+ * tile is added, as the engine does it: 2 (9 times in 10) or 4
+ * on any free cell but cell 0, each cell being as likely.
+ *
+ * Only small boards, or low game types, can be done: the values
+ * are kept as floats, for every combination of tiles, so even a
+ * 3x3 board stops at game type 7 (128.) Build it for a smaller
+ * board with e.g.:
+ *
+ *   ./configure CPPFLAGS="-DBOARD_WIDTH=3 -DBOARD_HEIGHT=3"
+ *   make clean tools/mktb
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "game.h"
+#include "policy.h"
+#include "tablebase.h"
+
+/* Most positions a tablebase can hold (4 bytes each while solving) */
+#define MAX_POSITIONS (1UL << 26)
+
+/* Values of positions that haven't been solved yet */
+#define UNSOLVED    -1.0f
+#define IN_PROGRESS -2.0f
+
+/* Number of cells */
+#define CELLS (BOARD_WIDTH * BOARD_HEIGHT)
+
+/* Value of each position, and the game type */
+static float *values = NULL;
+static int type;
+
+/* Positions solved */
+static unsigned long solved = 0;
+
+static float solve(const struct game *g);
+
+/**
+ * Find a position in the tablebase.
+ *
+ * \param[in] g Game state (no tile may be type or higher.)
+ * \return Index of the position.
+ */
+static unsigned long position(const struct game *g)
+{
+	unsigned long i = 0;
+	int c;
+
+	for (c = CELLS - 1; c >= 0; c--)
+		i = i * (unsigned long)type + (unsigned long)g->board[c];
+	return i;
+}
+
+/**
+ * Find the chance of winning from a position that a tile
+ * has just been added to (or couldn't be.)
+ *
+ * \param[in] g Game state.
+ * \return The chance of winning.
+ */
+static float after_tile(const struct game *g)
+{
+	/**
+	 * A game that's been won is over if the new tile leaves no
+	 * move, as game_move() has it.
+	 */
+	if (game_is_over(g)) {
+		if (g->game_state != GAME_WON)
+			values[position(g)] = 0.0f;
+		return 0.0f;
+	}
+
+	return g->game_state == GAME_WON ? 1.0f : solve(g);
+}
+
+/**
+ * Find the chance of winning from a position, before the
+ * player's move.
+ *
+ * \param[in] g Game state.
+ * \return The chance of winning.
+ */
+static float solve(const struct game *g)
+{
+	unsigned long i = position(g);
+	struct game t, u;
+	float v, best = 0.0f;
+	int move, c, n;
+
+	if (values[i] >= 0.0f) return values[i];
+
+	/**
+	 * Moves that leave only cell 0 free add no tile, so a game
+	 * can come back to a position it has been in, without ever
+	 * being won that way. Counting such a move as lost can
+	 * undervalue a position slightly, but never overvalues one.
+	 */
+	if (values[i] == IN_PROGRESS) return 0.0f;
+	values[i] = IN_PROGRESS;
+
+	for (move = MOVE_UP; move <= MOVE_RIGHT && best < 1.0f; move++) {
+		t = *g;
+		if (!game_slide(&t, move)) continue;
+
+		for (c = 1, n = 0, v = 0.0f; c < CELLS; c++) {
+			if (t.board[c]) continue;
+
+			u = t;
+			game_place_tile(&u, c, 1);
+			v += 0.9f * after_tile(&u);
+
+			u = t;
+			game_place_tile(&u, c, 2);
+			v += 0.1f * after_tile(&u);
+			n++;
+		}
+
+		v = n ? v / (float)n : after_tile(&t);
+		if (v > best) best = v;
+	}
+
+	solved++;
+	values[i] = best;
+	return best;
+}
+
+/**
+ * Solve every position reachable from the start of a game.
+ *
+ * \return The chance of winning a new game.
+ */
+static double solve_starts(void)
+{
+	unsigned char packed[PACKED_BOARD_SIZE];
+	struct game g, empty;
+	double p = 0.0;
+	int c1, c2, e1, e2;
+
+	memset(packed, 0, sizeof(packed));
+	init_game_state(&empty, type, 0);
+	game_unpack_board(&empty, packed);
+
+	/* Games start with two tiles, added as any other. */
+	for (c1 = 1; c1 < CELLS; c1++) {
+		for (c2 = 1; c2 < CELLS; c2++) {
+			if (c1 == c2) continue;
+			for (e1 = 1; e1 <= 2; e1++) {
+				for (e2 = 1; e2 <= 2; e2++) {
+					g = empty;
+					game_place_tile(&g, c1, e1);
+					game_place_tile(&g, c2, e2);
+					p += (e1 == 1 ? 0.9 : 0.1) *
+					     (e2 == 1 ? 0.9 : 0.1) *
+					     (double)solve(&g);
+				}
+			}
+		}
+	}
+
+	return p / (double)(CELLS - 1) / (double)(CELLS - 2);
+}
+
+/**
+ * Write the tablebase.
+ *
+ * \param[in] file Path to the file.
+ * \param[in] n    Number of positions.
+ * \return NULL on success, error message on error.
+ */
+static const char *write_tablebase(const char *file, unsigned long n)
+{
+	unsigned char buf[16];
+	unsigned long i, v;
+	FILE *fp;
+
+	if (!(fp = fopen(file, "wb")))
+		return "unable to write the tablebase";
+
+	memset(buf, 0, sizeof(buf));
+	memcpy(buf, "tp2b", 4);
+	buf[4] = TABLEBASE_VERSION;
+	buf[5] = BOARD_WIDTH;
+	buf[6] = BOARD_HEIGHT;
+	buf[7] = (unsigned char)type;
+	buf[8] = (unsigned char)(n >> 24);
+	buf[9] = (unsigned char)(n >> 16);
+	buf[10] = (unsigned char)(n >> 8);
+	buf[11] = (unsigned char)n;
+	fwrite(buf, sizeof(buf), 1, fp);
+
+	for (i = 0; i < n; i++) {
+		v = values[i] < 0.0f ? 0xffffUL :
+		    (unsigned long)(values[i] * (float)TABLEBASE_ONE + 0.5f);
+		putc((int)(v >> 8), fp);
+		putc((int)(v & 0xff), fp);
+	}
+
+	if (ferror(fp) | fclose(fp)) {
+		remove(file);
+		return "unable to write the tablebase";
+	}
+
+	return NULL;
+}
+
+/**
+ * Play games with expectimax, and count how many are won.
+ *
+ * \param[in] games Number of games.
+ * \return The number of games won.
+ */
+static unsigned long play(unsigned long games)
+{
+	struct policy p = { "expectimax/2", POLICY_EXPECTIMAX, 2, 0, NULL };
+	unsigned long seed, won = 0;
+	struct game g;
+
+	for (seed = 1; seed <= games; seed++) {
+		p.rng = seed ^ 0x9e3779b9UL;
+		init_game_state(&g, type, seed);
+		while (!g.game_state)
+			game_move(&g, policy_move(&p, &g));
+		won += g.game_state == GAME_WON;
+	}
+
+	return won;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *err = NULL;
+	unsigned long i, n = 1, games = 0, with, without;
+	double p;
+	clock_t start;
+
+	if (argc > 2 && !strcmp(argv[1], "-p")) {
+		games = strtoul(argv[2], NULL, 10);
+		argc -= 2;
+		argv += 2;
+	}
+
+	if (argc != 3 || (type = atoi(argv[1])) < 2 || type > 15) {
+		fprintf(stderr, "Usage: mktb [-p games] game_type file\n");
+		fprintf(stderr, "\t-p games: Check the tablebase by playing "
+		        "games with it\n");
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < CELLS; i++) {
+		if (n > MAX_POSITIONS / (unsigned long)type) {
+			fprintf(stderr, "error: a %dx%d board with game type %d "
+			        "has too many positions.\n", BOARD_WIDTH,
+			        BOARD_HEIGHT, type);
+			return EXIT_FAILURE;
+		}
+		n *= (unsigned long)type;
+	}
+
+	if (!(values = malloc(n * sizeof(float)))) {
+		fputs("error: unable to allocate the tablebase\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < n; i++)
+		values[i] = UNSOLVED;
+
+	start = clock();
+	p = solve_starts();
+	printf("%dx%d, game type %d: %lu of %lu positions reachable, "
+	       "solved in %.1fs.\n", BOARD_WIDTH, BOARD_HEIGHT, type, solved,
+	       n, (double)(clock() - start) / CLOCKS_PER_SEC);
+	printf("A new game is won at least %.4f%% of the time, with the "
+	       "best play.\n", p * 100.0);
+
+	err = write_tablebase(argv[2], n);
+	free(values);
+	if (err) goto err;
+
+	/* Read the tablebase back, as the policies would. */
+	if (games) {
+		without = play(games);
+		if ((err = tablebase_load(argv[2]))) goto err;
+		with = play(games);
+		tablebase_unload();
+
+		printf("expectimax/2 won %lu of %lu games with the tablebase, "
+		       "and %lu without it.\n", with, games, without);
+	}
+
+err:
+	if (err) {
+		fprintf(stderr, "error: %s\n", err);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,324 @@
+/**
+ * tp2 - N-tuple Network Trainer
+ * Copyright (C) 2015 Tim Hentenaar.
+ *
+ * This code is licenced under the Simplified BSD License.
+ * See the LICENSE file for details.
+ *
+ * Trains an n-tuple network (see src/ntuple.h) by self-play,
+ * with temporal difference learning on afterstates: after each
+ * move, the value of the board the previous move left is moved
+ * towards the points this move scored, plus the value of the
+ * board it leaves.
+ *
+ * Each round, the worker processes play their share of the games
+ * on the same weights, which live in shared memory, and update
+ * them as they go without any locking (as in "Hogwild!"), since
+ * two workers rarely touch the same weight at once, and a lost
+ * update costs little. The weights are saved after every round.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "game.h"
+#include "ntuple.h"
+#include "save.h"
+#include "stats.h"
+
+#if BOARD_WIDTH != 4 || BOARD_HEIGHT != 4
+#error "N-tuple networks only work on a 4x4 board."
+#endif
+
+/* Maximum number of worker processes */
+#define MAX_WORKERS 64
+
+/* Weights, shared by every worker */
+static float *weights = NULL;
+
+/**
+ * Show usage information.
+ */
+static void usage(char *argv0)
+{
+	printf("Usage: %s [-t game_type] [-g games] [-r rounds] "
+	       "[-j workers] [-a alpha] [-s seed] file\n", argv0);
+	puts("\t-t game_type: Game type to train on (10 - 15, default: 11)");
+	puts("\t-g games:     Games per round (default: 10000)");
+	puts("\t-r rounds:    Rounds to train for (default: 10)");
+	puts("\t-j workers:   Number of processes (default: 1)");
+	puts("\t-a alpha:     Learning rate (default: 0.0025)");
+	puts("\t-s seed:      Seed for the first game (default: the time)\n");
+	puts("\tThe weights are read from file, if it exists, and saved");
+	puts("\tto it after every round.");
+}
+
+/**
+ * Get the wall-clock time in seconds.
+ *
+ * \return The time.
+ */
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+}
+
+/**
+ * Play one game, learning from every move.
+ *
+ * Moves are chosen greedily: the random tiles make the games
+ * varied enough without exploring.
+ *
+ * \param[in]  seed  Seed for the game.
+ * \param[in]  type  Game type.
+ * \param[in]  alpha Learning rate.
+ * \param[out] s     Statistics to add the game to.
+ */
+static void train(unsigned long seed, int type, float alpha,
+                  struct stats *s)
+{
+	struct game g, after, best_after, prev;
+	unsigned long points = 0, moves = 0;
+	float v, best = 0.0f;
+	int i, move, have_prev = 0;
+
+	init_game_state(&g, type, seed);
+	while (!g.game_state) {
+		for (i = MOVE_UP, move = -1; i <= MOVE_RIGHT; i++) {
+			after = g;
+			if (!game_slide(&after, i)) continue;
+
+			v = (float)after.reward + ntuple_value(weights, &after);
+			if (move < 0 || v > best) {
+				best = v;
+				best_after = after;
+				move = i;
+			}
+		}
+		if (move < 0) break;
+
+		if (have_prev)
+			ntuple_update(weights, &prev, alpha *
+			              (best - ntuple_value(weights, &prev)));
+		prev = best_after;
+		have_prev = 1;
+
+		game_move(&g, move);
+		points += g.reward;
+		moves++;
+		stats_add_move(s, &g);
+	}
+
+	/* Nothing follows the board the last move left. */
+	if (have_prev)
+		ntuple_update(weights, &prev,
+		              -alpha * ntuple_value(weights, &prev));
+	stats_add_game(s, &g, points, moves);
+}
+
+/**
+ * Read a whole set of statistics from a worker.
+ *
+ * \param[in]  fd Pipe from the worker.
+ * \param[out] s  Statistics.
+ * \return 1 if they were read, 0 otherwise.
+ */
+static int read_stats(int fd, struct stats *s)
+{
+	size_t got = 0;
+	ssize_t n;
+
+	while (got < sizeof(*s)) {
+		n = read(fd, (char *)s + got, sizeof(*s) - got);
+		if (n <= 0) return 0;
+		got += (size_t)n;
+	}
+
+	return 1;
+}
+
+/**
+ * Play one round of games, split between the workers.
+ *
+ * \param[in]  first   Seed for the round's first game.
+ * \param[in]  games   Games to play.
+ * \param[in]  workers Number of worker processes.
+ * \param[in]  type    Game type.
+ * \param[in]  alpha   Learning rate.
+ * \param[out] total   Statistics for the round.
+ * \return NULL on success, error message on error.
+ */
+static const char *round_run(unsigned long first, long games, int workers,
+                             int type, float alpha, struct stats *total)
+{
+	int fds[MAX_WORKERS];
+	const char *err = NULL;
+	struct stats s;
+	long i;
+	int w, fd[2];
+	pid_t pid;
+
+	memset(total, 0, sizeof(*total));
+	for (w = 0; w < workers; w++) {
+		fds[w] = -1;
+		if (pipe(fd)) {
+			err = "unable to start a worker";
+			break;
+		}
+
+		if (!(pid = fork())) {
+			close(fd[0]);
+			memset(&s, 0, sizeof(s));
+			for (i = w; i < games; i += workers)
+				train(first + (unsigned long)i, type, alpha, &s);
+
+			if (write(fd[1], &s, sizeof(s)) != sizeof(s))
+				_exit(EXIT_FAILURE);
+			_exit(EXIT_SUCCESS);
+		}
+
+		close(fd[1]);
+		if (pid == -1) {
+			close(fd[0]);
+			err = "unable to start a worker";
+			break;
+		}
+		fds[w] = fd[0];
+	}
+
+	while (w--) {
+		if (read_stats(fds[w], &s))
+			stats_merge(total, &s);
+		close(fds[w]);
+	}
+	while (wait(NULL) > 0);
+
+	if (!err && total->games != (unsigned long)games)
+		err = "a worker failed to finish its games";
+	return err;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *err = NULL, *file = NULL;
+	unsigned long seed = (unsigned long)time(NULL);
+	long games = 10000;
+	int i, shmid, type = 11, rounds = 10, workers = 1;
+	float alpha = 0.0025f;
+	struct stats s;
+	double start, t;
+	FILE *fp;
+
+	/* Handle args: options, then the weights file */
+	for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+		switch (argv[i][1]) {
+		case 't': /* -t: Game type (10 - 15) */
+			type = atoi(argv[i + 1]);
+			if (type < 10 || type > 15) {
+				err = "game type must be between 10 and 15.";
+				goto err;
+			}
+			break;
+		case 'g': /* -g: Games per round */
+			if ((games = atol(argv[i + 1])) < 1) {
+				err = "the number of games must be positive.";
+				goto err;
+			}
+			break;
+		case 'r': /* -r: Rounds */
+			if ((rounds = atoi(argv[i + 1])) < 1) {
+				err = "the number of rounds must be positive.";
+				goto err;
+			}
+			break;
+		case 'j': /* -j: Worker processes */
+			workers = atoi(argv[i + 1]);
+			if (workers < 1 || workers > MAX_WORKERS) {
+				err = "the number of workers must be between 1 and 64.";
+				goto err;
+			}
+			break;
+		case 'a': /* -a: Learning rate */
+			alpha = (float)atof(argv[i + 1]);
+			if (alpha <= 0.0f || alpha > 1.0f) {
+				err = "the learning rate must be above 0, and at most 1.";
+				goto err;
+			}
+			break;
+		case 's': /* -s: Seed */
+			seed = strtoul(argv[i + 1], NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (i != argc - 1) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	file = argv[i];
+
+	/**
+	 * The segment is removed straight away: it stays around
+	 * for as long as we (and the workers) are attached to it.
+	 */
+	shmid = shmget(IPC_PRIVATE, NTUPLE_WEIGHTS * sizeof(float),
+	               IPC_CREAT | 0600);
+	if (shmid == -1) {
+		err = "unable to allocate the weights";
+		goto err;
+	}
+
+	weights = shmat(shmid, NULL, 0);
+	shmctl(shmid, IPC_RMID, NULL);
+	if (weights == (float *)-1) {
+		weights = NULL;
+		err = "unable to allocate the weights";
+		goto err;
+	}
+
+	/* Carry on from where the last run left off. */
+	if ((fp = fopen(file, "rb"))) {
+		fclose(fp);
+		if ((err = load_weights(file, weights, NTUPLE_WEIGHTS)))
+			goto err;
+	}
+
+	for (i = 0; i < rounds; i++) {
+		start = now();
+		err = round_run(seed, games, workers, type, alpha, &s);
+		if (err) goto err;
+		seed += (unsigned long)games;
+		t = now() - start;
+
+		printf("round=%d moves/s=%.0f ", i + 1,
+		       t > 0.0 ? (double)s.moves / t : 0.0);
+		stats_write(&s, stdout, (unsigned long)t);
+		fflush(stdout);
+
+		if ((err = save_weights(file, weights, NTUPLE_WEIGHTS)))
+			goto err;
+	}
+
+err:
+	if (weights) shmdt((void *)weights);
+	if (err) {
+		fprintf(stderr, "error: %s\n", err);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}